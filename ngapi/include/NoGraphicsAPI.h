@@ -18,6 +18,32 @@ Texture2D<float4> textureHeap[];
 [[vk::binding(0, 1)]]
 RWTexture2D<float4> rwTextureHeap[];
 
+// The same heaps viewed through layered texture types. Index them with the
+// slot of a 2D array, cube or cube array view descriptor.
+[[vk::binding(0, 0)]]
+Texture2DArray<float4> textureHeap2DArray[];
+
+[[vk::binding(0, 0)]]
+TextureCube<float4> textureHeapCube[];
+
+[[vk::binding(0, 0)]]
+TextureCubeArray<float4> textureHeapCubeArray[];
+
+[[vk::binding(0, 1)]]
+RWTexture2DArray<float4> rwTextureHeap2DArray[];
+
+// Shader-side layout of GpuAccelerationStructureInstanceDesc
+// (VkAccelerationStructureInstanceKHR), for building TLAS instance arrays on
+// the GPU. blasAddress comes from gpuAccelerationStructureAddress; 0 marks an
+// inactive instance.
+struct GpuAccelerationStructureInstance
+{
+    float4 transform[3]; // row-major 3x4
+    uint instanceIDAndMask; // instanceID (24) | instanceMask << 24
+    uint hitGroupIndexAndFlags; // hitGroupIndex (24) | flags << 24
+    uint64_t blasAddress;
+};
+
 #endif
 
 // Software samplers: plain-data sampler state with shader-code filtering.
@@ -127,7 +127,13 @@ enum OP
     OP_GREATER_EQUAL,
     OP_ALWAYS,
     OP_KEEP,
-    OP_ZERO
+    OP_ZERO,
+    OP_REPLACE,
+    OP_INCREMENT_CLAMP,
+    OP_DECREMENT_CLAMP,
+    OP_INVERT,
+    OP_INCREMENT_WRAP,
+    OP_DECREMENT_WRAP
 };
 enum BLEND
 {
@@ -157,7 +163,16 @@ enum TOPOLOGY
 {
     TOPOLOGY_TRIANGLE_LIST,
     TOPOLOGY_TRIANGLE_STRIP,
-    TOPOLOGY_TRIANGLE_FAN
+    TOPOLOGY_TRIANGLE_FAN,
+    TOPOLOGY_POINT_LIST,
+    TOPOLOGY_LINE_LIST,
+    TOPOLOGY_LINE_STRIP
+};
+enum FILL_MODE
+{
+    FILL_SOLID,
+    FILL_WIREFRAME,
+    FILL_POINTS
 };
 enum TEXTURE
 {
@@ -179,7 +194,44 @@ enum FORMAT
     FORMAT_RGB32_FLOAT,
     FORMAT_RG32_FLOAT,
     FORMAT_RGBA32_FLOAT,
-    FORMAT_RGBA16_FLOAT /*, ...*/
+    FORMAT_RGBA16_FLOAT,
+    FORMAT_RGBA8_SRGB,
+    FORMAT_R8_UNORM,
+    FORMAT_RG8_UNORM,
+    FORMAT_R16_FLOAT,
+    FORMAT_RG16_FLOAT,
+    FORMAT_R32_FLOAT,
+    FORMAT_R32_UINT,
+    FORMAT_D16_UNORM,
+    FORMAT_D24_UNORM_S8_UINT,
+    FORMAT_D32_FLOAT_S8_UINT,
+    FORMAT_S8_UINT,
+    // Block-compressed (4x4 blocks unless noted). Check gpuFormatSupported:
+    // BC is desktop, ETC2/ASTC are mostly mobile.
+    FORMAT_BC1_RGBA_UNORM,
+    FORMAT_BC1_RGBA_SRGB,
+    FORMAT_BC2_UNORM,
+    FORMAT_BC2_SRGB,
+    FORMAT_BC3_UNORM,
+    FORMAT_BC3_SRGB,
+    FORMAT_BC4_UNORM,
+    FORMAT_BC4_SNORM,
+    FORMAT_BC5_UNORM,
+    FORMAT_BC5_SNORM,
+    FORMAT_BC6H_UFLOAT,
+    FORMAT_BC6H_SFLOAT,
+    FORMAT_BC7_UNORM,
+    FORMAT_BC7_SRGB,
+    FORMAT_ETC2_RGB8_UNORM,
+    FORMAT_ETC2_RGB8_SRGB,
+    FORMAT_ETC2_RGBA8_UNORM,
+    FORMAT_ETC2_RGBA8_SRGB,
+    FORMAT_ASTC_4x4_UNORM,
+    FORMAT_ASTC_4x4_SRGB,
+    FORMAT_ASTC_6x6_UNORM, // 6x6 blocks
+    FORMAT_ASTC_6x6_SRGB,
+    FORMAT_ASTC_8x8_UNORM, // 8x8 blocks
+    FORMAT_ASTC_8x8_SRGB /*, ...*/
 };
 enum USAGE_FLAGS
 {
@@ -188,7 +240,8 @@ enum USAGE_FLAGS
     USAGE_COLOR_ATTACHMENT = 1 << 2,
     USAGE_DEPTH_STENCIL_ATTACHMENT = 1 << 3,
     USAGE_TRANSFER_DST = 1 << 4,
-    USAGE_TRANSFER_SRC = 1 << 5 /*, ...*/
+    USAGE_TRANSFER_SRC = 1 << 5,
+    USAGE_TRANSIENT = 1 << 6 // attachment contents never leave the pass (MSAA, depth); see gpuCreateTexture
 };
 enum STAGE
 {
@@ -234,12 +287,24 @@ enum TYPE
     TYPE_BOTTOM_LEVEL,
     TYPE_TOP_LEVEL
 };
+#endif // GPU_RAY_TRACING_EXTENSION
 enum LOAD_OP
 {
     LOAD_OP_CLEAR,
     LOAD_OP_LOAD
 };
-#endif // GPU_RAY_TRACING_EXTENSION
+enum STORE_OP
+{
+    STORE_OP_STORE,
+    STORE_OP_DONT_CARE
+};
+enum RESOLVE
+{
+    RESOLVE_AVERAGE,
+    RESOLVE_SAMPLE_ZERO,
+    RESOLVE_MIN,
+    RESOLVE_MAX
+};
 
 // View descriptor constants
 constexpr uint8_t ALL_MIPS = 0xFF;
@@ -285,19 +350,63 @@ struct ColorTarget
     uint8_t writeMask = 0xf;
 };
 
+// topology, cull, primitiveRestart and fillMode are the pipeline's starting
+// values; the matching gpuSet* commands change them per command buffer.
+// primitiveRestart applies to strips and fans (index 0xFFFFFFFF).
 struct GpuRasterDesc
 {
     TOPOLOGY topology = TOPOLOGY_TRIANGLE_LIST;
     CULL cull = CULL_NONE;
+    bool primitiveRestart = false;
+    FILL_MODE fillMode = FILL_SOLID;
     bool alphaToCoverage = false;
     bool supportDualSourceBlending = false;
     uint8_t sampleCount = 1;
     FORMAT depthFormat = FORMAT_NONE;
     FORMAT stencilFormat = FORMAT_NONE;
+    uint32_t viewMask = 0; // must equal the viewMask of the render passes it draws in
     Span<ColorTarget> colorTargets = {};
     GpuBlendDesc* blendState = nullptr; // optional embedded blend state
 };
 
+// User specialization constant: `size` bytes (4 for bool/int/uint/float, 8
+// for 64-bit types) of `value`'s bit pattern go to SpecId `id`. Constants are
+// offered to every stage of the pipeline; stages without that SpecId ignore
+// them. SpecIds used by STATIC_SAMPLER declarations are reserved: a constant
+// naming one in any stage is an error (logged and asserted; release builds
+// keep the sampler's value).
+struct GpuSpecConstant
+{
+    uint32_t id = 0;
+    uint32_t size = 4;
+    uint64_t value = 0;
+};
+
+// One entry of a gpuCreateComputePipelines batch.
+struct GpuComputePipelineDesc
+{
+    ByteSpan computeIR = {};
+    const char* entry = "main";
+    Span<GpuSpecConstant> specConstants = {};
+};
+
+// One entry of a gpuCreateGraphicsPipelines batch: set vertexIR for a vertex
+// pipeline or meshletIR for a mesh pipeline. vertexEntry names the vertex or
+// mesh entry point, so one multi-entry .spv can feed every variant.
+struct GpuGraphicsPipelineDesc
+{
+    ByteSpan vertexIR = {};
+    ByteSpan meshletIR = {};
+    ByteSpan pixelIR = {};
+    GpuRasterDesc raster = {};
+    const char* vertexEntry = "main";
+    const char* pixelEntry = "main";
+    Span<GpuSpecConstant> specConstants = {};
+};
+
+// layerCount is the number of array slices; for TEXTURE_CUBE and
+// TEXTURE_CUBE_ARRAY it counts whole cubes (six faces each), so views and
+// copies address 6 * layerCount layers. dimensions.z is only read for 3D.
 struct GpuTextureDesc
 {
     TEXTURE type = TEXTURE_2D;
@@ -309,6 +418,10 @@ struct GpuTextureDesc
     USAGE_FLAGS usage = USAGE_SAMPLED;
 };
 
+// Selects a mip/layer sub-range for a view descriptor. Layers are Vulkan
+// array layers (cube faces count individually). A single layer is viewed as
+// 2D; see textureHeap2DArray / textureHeapCube in NoGraphicsAPI.h for the
+// array and cube views. format is FORMAT_NONE or the texture's own format.
 struct GpuViewDesc
 {
     FORMAT format = FORMAT_NONE;
@@ -318,11 +431,67 @@ struct GpuViewDesc
     uint16_t layerCount = ALL_LAYERS;
 };
 
+// A box inside one mip of a texture, across a run of array layers. Layers
+// count like GpuViewDesc (cube faces individually). A zero extent axis runs
+// to the edge of the mip from offset.
+struct GpuTextureRegion
+{
+    uint32_t mip = 0;
+    uint16_t baseLayer = 0;
+    uint16_t layerCount = ALL_LAYERS;
+    uint3 offset = { 0, 0, 0 };
+    uint3 extent = { 0, 0, 0 };
+    bool stencil = false; // stencil aspect of a depth/stencil texture (1 byte per texel in buffers)
+};
+
+// Buffer side of a buffer<->texture copy. rowPitch is the byte stride between
+// rows of blocks and slicePitch between depth slices / layers; 0 means
+// tightly packed. Pitches must be whole multiples of the format's block size.
+struct GpuBufferTextureCopy
+{
+    void* bufferGpu = nullptr;
+    uint32_t rowPitch = 0;
+    uint32_t slicePitch = 0;
+    GpuTextureRegion region = {};
+};
+
+// Texture-to-texture copy: src's box lands at dst's mip/layers/offset (dst's
+// extent is ignored). Formats must be size-compatible.
+struct GpuTextureCopy
+{
+    GpuTextureRegion src = {};
+    GpuTextureRegion dst = {};
+};
+
+// depthStencilTarget may be a depth, combined depth/stencil or stencil-only
+// texture; each aspect it has is attached. Stencil loads, stores and clears
+// independently of color and depth, so a mask can outlive the pass.
+// A non-zero viewMask (bits below gpuMaxViewCount) broadcasts each draw to the
+// named layers of every target (SV_ViewID is the layer); otherwise layerCount
+// layers are bound and shaders select one with SV_RenderTargetArrayIndex
+// (e.g. instanced shadow cascades). Depth-only passes take their render area
+// from the depth target.
+// Multisampled targets resolve at the end of the pass into the matching
+// single-sample resolveTargets entry (nullptr skips a target). Color resolves
+// with colorResolve (AVERAGE needs a float/unorm format); depth with
+// depthResolve (MIN/MAX where the device supports them) and stencil with
+// SAMPLE_ZERO, or with depthResolve on a combined target when the device
+// can't resolve the aspects independently (AVERAGE is then unsupported).
+// USAGE_TRANSIENT targets that resolve are not stored.
 struct GpuRenderPassDesc
 {
     Span<GpuTexture> colorTargets = {};
     GpuTexture depthStencilTarget = nullptr;
     LOAD_OP loadOp = LOAD_OP_CLEAR;
+    LOAD_OP stencilLoadOp = LOAD_OP_CLEAR;
+    STORE_OP stencilStoreOp = STORE_OP_STORE;
+    uint8_t clearStencil = 0;
+    uint32_t viewMask = 0;
+    uint32_t layerCount = 1;
+    Span<GpuTexture> resolveTargets = {};
+    GpuTexture depthStencilResolveTarget = nullptr;
+    RESOLVE colorResolve = RESOLVE_AVERAGE;
+    RESOLVE depthResolve = RESOLVE_SAMPLE_ZERO;
 };
 
 struct GpuIndirectDrawArgs
@@ -347,6 +516,16 @@ struct GpuTextureSizeAlign
     size_t size;
     size_t align;
 };
+// Texel block layout of a format: 1x1 blocks for uncompressed formats, so
+// bytes is then the texel size. A tightly packed mip row of N texels holds
+// ceil(N / width) blocks of `bytes` each; a mip holds ceil(H / height) rows.
+struct GpuFormatBlock
+{
+    uint32_t bytes;
+    uint32_t width;
+    uint32_t height;
+};
+
 struct GpuTextureDescriptor
 {
     uint64_t data[4];
@@ -394,6 +573,9 @@ struct GpuAccelerationStructureBlasDesc
     Span<GpuAccelerationStructureAabbsDesc> aabbs = {};
 };
 
+// instancesGpu may be MEMORY_GPU written by a compute shader (see
+// GpuAccelerationStructureInstance in NoGraphicsAPI.h); barrier
+// STAGE_COMPUTE -> STAGE_ACCELERATION_STRUCTURE_BUILD before building.
 struct GpuAccelerationStructureTlasDesc
 {
     bool arrayOfPointers = false;
@@ -427,9 +609,29 @@ void* gpuVulkanInstance();
 GpuSurface gpuCreateSurface(void* vulkanSurface, uint32_t fallbackWidth = 0, uint32_t fallbackHeight = 0);
 void* gpuVulkanSurface(GpuSurface surface);
 void gpuDestroySurface(GpuSurface surface);
+// gpuTextureSizeAlign's answer with the memory types it allows, from the
+// memo (or the driver on a miss), and the same answered the pre-memo way: a
+// VkImage is created, vkGetImageMemoryRequirements asked and the image
+// destroyed. For cross-checks and baselines (samples/texturebench).
+struct GpuTextureMemoryRequirements
+{
+    size_t size;
+    size_t align;
+    uint32_t memoryTypeBits;
+};
+GpuTextureMemoryRequirements gpuTextureMemoryRequirements(GpuDevice device, GpuTextureDesc desc);
+GpuTextureMemoryRequirements gpuTextureMemoryRequirementsFromImage(GpuDevice device, GpuTextureDesc desc);
 #endif // GPU_EXPOSE_INTERNAL
 
 // Instance
+// Environment switches (set before the call that reads them; any value):
+//   NGAPI_VALIDATION            gpuCreateInstance enables the Khronos
+//                               validation layer (off by default: it
+//                               serializes recording, see docs/multithreading.md)
+//   NGAPI_NO_INDIRECT_AS_BUILD  gpuCreateDevice leaves indirect acceleration
+//                               structure builds off even where supported, so
+//                               gpuBuildAccelerationStructuresIndirect takes its
+//                               direct-build fallback (tests cover both paths)
 RESULT gpuCreateInstance();
 void gpuDestroyInstance();
 
@@ -440,6 +642,9 @@ GpuDeviceDesc gpuDeviceDesc(uint32_t index);
 // Device
 GpuDevice gpuCreateDevice(uint32_t deviceIndex);
 void gpuDestroyDevice(GpuDevice device);
+// Views a multiview pass can broadcast to (GpuRenderPassDesc::viewMask);
+// 0 where the device has no multiview support.
+uint32_t gpuMaxViewCount(GpuDevice device);
 
 // Memory
 void* gpuMalloc(GpuDevice device, size_t bytes, MEMORY memory = MEMORY_DEFAULT);
@@ -448,16 +653,39 @@ void gpuFree(GpuDevice device, void* ptr);
 void* gpuHostToDevicePointer(GpuDevice device, void* ptr);
 
 // Textures
+GpuFormatBlock gpuFormatBlock(FORMAT format);
+// True when `format` can be created with `usage` (optimal tiling) on this
+// device, so callers can fall back e.g. from BC7 to RGBA8.
+bool gpuFormatSupported(GpuDevice device, FORMAT format, USAGE_FLAGS usage);
 GpuTextureSizeAlign gpuTextureSizeAlign(GpuDevice device, GpuTextureDesc desc);
+// USAGE_TRANSIENT textures may pass a null ptrGpu: they then get their own
+// lazily allocated memory (tile memory on mobile GPUs), or device-local
+// memory where the device has no lazy memory type. Returns nullptr if that
+// allocation fails.
 GpuTexture gpuCreateTexture(GpuDevice device, GpuTextureDesc desc, void* ptrGpu);
 void gpuDestroyTexture(GpuTexture texture);
 GpuTextureDescriptor gpuTextureViewDescriptor(GpuTexture texture, GpuViewDesc desc);
 GpuTextureDescriptor gpuRWTextureViewDescriptor(GpuTexture texture, GpuViewDesc desc);
 
 // Pipelines
-GpuPipeline gpuCreateComputePipeline(GpuDevice device, ByteSpan computeIR, const char* entry = "main");
-GpuPipeline gpuCreateGraphicsPipeline(GpuDevice device, ByteSpan vertexIR, ByteSpan pixelIR, GpuRasterDesc desc);
-GpuPipeline gpuCreateGraphicsMeshletPipeline(GpuDevice device, ByteSpan meshletIR, ByteSpan pixelIR, GpuRasterDesc desc);
+GpuPipeline gpuCreateComputePipeline(GpuDevice device, ByteSpan computeIR, const char* entry = "main", Span<GpuSpecConstant> specConstants = {});
+GpuPipeline gpuCreateGraphicsPipeline(GpuDevice device, ByteSpan vertexIR, ByteSpan pixelIR, GpuRasterDesc desc,
+                                      const char* vertexEntry = "main", const char* pixelEntry = "main", Span<GpuSpecConstant> specConstants = {});
+GpuPipeline gpuCreateGraphicsMeshletPipeline(GpuDevice device, ByteSpan meshletIR, ByteSpan pixelIR, GpuRasterDesc desc,
+                                             const char* meshletEntry = "main", const char* pixelEntry = "main", Span<GpuSpecConstant> specConstants = {});
+// Batch creation: pipelines[i] receives descs[i]. Work is split into chunks
+// of several pipelines per driver call and spread across all cores; returns
+// once every pipeline is created.
+void gpuCreateComputePipelines(GpuDevice device, Span<GpuComputePipelineDesc> descs, Span<GpuPipeline> pipelines);
+void gpuCreateGraphicsPipelines(GpuDevice device, Span<GpuGraphicsPipelineDesc> descs, Span<GpuPipeline> pipelines);
+// Async creation: returns at once and compiles on a background worker. Until
+// gpuPipelineReady, gpuSetPipeline binds `fallback` (same bind point, must be
+// ready itself) or, without one, skips the dispatches/draws that follow it.
+// gpuWaitPipeline blocks until compiled; gpuFreePipeline waits as well.
+GpuPipeline gpuCreateComputePipelineAsync(GpuDevice device, GpuComputePipelineDesc desc, GpuPipeline fallback = nullptr);
+GpuPipeline gpuCreateGraphicsPipelineAsync(GpuDevice device, GpuGraphicsPipelineDesc desc, GpuPipeline fallback = nullptr);
+bool gpuPipelineReady(GpuPipeline pipeline);
+void gpuWaitPipeline(GpuPipeline pipeline);
 void gpuFreePipeline(GpuPipeline pipeline);
 
 // State objects
@@ -490,7 +718,13 @@ void gpuDestroySemaphore(GpuSemaphore sema);
 void gpuMemCpy(GpuCommandBuffer cb, void* destGpu, void* srcGpu, uint64_t size);
 void gpuCopyToTexture(GpuCommandBuffer cb, void* srcGpu, GpuTexture texture);
 void gpuCopyFromTexture(GpuCommandBuffer cb, void* destGpu, GpuTexture texture);
+void gpuCopyToTexture(GpuCommandBuffer cb, GpuTexture texture, Span<GpuBufferTextureCopy> regions);
+void gpuCopyFromTexture(GpuCommandBuffer cb, GpuTexture texture, Span<GpuBufferTextureCopy> regions);
+void gpuCopyTexture(GpuCommandBuffer cb, GpuTexture destTexture, GpuTexture srcTexture, Span<GpuTextureCopy> regions);
 void gpuBlitTexture(GpuCommandBuffer cb, GpuTexture destTexture, GpuTexture srcTexture);
+void gpuGenerateMips(GpuCommandBuffer cb, GpuTexture texture);
+// False for formats gpuGenerateMips can't blit (block-compressed, most depth).
+bool gpuGenerateMipsSupported(GpuDevice device, FORMAT format);
 
 void gpuSetActiveTextureHeapPtr(GpuCommandBuffer cb, void* ptrGpu);
 
@@ -502,6 +736,21 @@ void gpuSetPipeline(GpuCommandBuffer cb, GpuPipeline pipeline);
 void gpuSetDepthStencilState(GpuCommandBuffer cb, GpuDepthStencilState state);
 void gpuSetBlendState(GpuCommandBuffer cb, GpuBlendState state);
 
+// Dynamic rasterizer state for the bound graphics pipeline; gpuSetPipeline
+// resets it to the pipeline's GpuRasterDesc. gpuSetTopology stays within the
+// pipeline's topology class (points, lines or triangles), and it and
+// gpuSetPrimitiveRestart do nothing on mesh pipelines. gpuSetFillMode needs
+// VK_EXT_extended_dynamic_state3 (polygon mode, see
+// gpuDynamicFillModeSupported); without it any mode but the bound pipeline's
+// is an error, so create one pipeline per fill mode instead.
+// Line widths other than 1 need the wideLines feature.
+void gpuSetCullMode(GpuCommandBuffer cb, CULL cull);
+void gpuSetTopology(GpuCommandBuffer cb, TOPOLOGY topology);
+void gpuSetPrimitiveRestart(GpuCommandBuffer cb, bool enable);
+bool gpuDynamicFillModeSupported(GpuDevice device);
+void gpuSetFillMode(GpuCommandBuffer cb, FILL_MODE mode);
+void gpuSetLineWidth(GpuCommandBuffer cb, float width);
+
 void gpuDispatch(GpuCommandBuffer cb, void* dataGpu, uint3 gridDimensions);
 void gpuDispatchIndirect(GpuCommandBuffer cb, void* dataGpu, void* gridDimensionsGpu);
 
@@ -530,7 +779,18 @@ void gpuPresent(GpuSwapchain swapchain, GpuSemaphore sema, uint64_t value);
 #ifdef GPU_RAY_TRACING_EXTENSION
 GpuAccelerationStructureSizes gpuAccelerationStructureSizes(GpuDevice device, GpuAccelerationStructureDesc desc);
 GpuAccelerationStructure gpuCreateAccelerationStructure(GpuDevice device, GpuAccelerationStructureDesc desc, void* ptrGpu, uint64_t size);
+// Total scratch bytes (alignment padding included) for building or updating
+// every structure in `as` with one gpuBuildAccelerationStructures call.
+size_t gpuAccelerationStructureScratchSize(Span<GpuAccelerationStructure> as, MODE mode);
 void gpuBuildAccelerationStructures(GpuCommandBuffer cb, Span<GpuAccelerationStructure> as, void* scratchGpu, MODE mode);
+// GPU-determined primitive/instance counts: rangesGpu holds one
+// GpuAccelerationStructureBuildRange per geometry, written by a shader. The
+// ranges passed at creation are the maximums. Falls back to a direct build
+// with those maximums where indirect builds are unsupported.
+void gpuBuildAccelerationStructuresIndirect(GpuCommandBuffer cb, Span<GpuAccelerationStructure> as, void* scratchGpu, void* rangesGpu, MODE mode);
+// Device address to store in GpuAccelerationStructureInstanceDesc::blasAddress,
+// on the CPU or from a shader producing the instance array.
+void* gpuAccelerationStructureAddress(GpuAccelerationStructure as);
 void gpuDestroyAccelerationStructure(GpuAccelerationStructure as);
 
 #endif // GPU_RAY_TRACING_EXTENSION
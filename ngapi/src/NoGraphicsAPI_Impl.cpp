@@ -7,15 +7,22 @@
 #include "PatchDescriptorsSpv.h"
 
 #include <map>
+#include <memory>
 #include <vector>
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <mutex>
 #include <shared_mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include "NoGraphicsAPI_Impl.h"
 
 struct GpuPipeline_T
@@ -23,6 +30,17 @@ struct GpuPipeline_T
     VkPipeline pipeline;
     VkPipelineBindPoint bindPoint;
     GpuDevice device;
+    // Async pipelines are handed out before `pipeline` exists; the worker
+    // publishes it by setting `ready` (release) and notifying waiters.
+    std::atomic<bool> ready = true;
+    GpuPipeline fallback = nullptr; // bound instead while not ready, if ready itself
+    // Graphics only: the GpuRasterDesc values gpuSetPipeline re-applies as
+    // dynamic state, so per-command-buffer overrides start from them.
+    bool meshlet = false;
+    CULL cull = CULL_NONE;
+    TOPOLOGY topology = TOPOLOGY_TRIANGLE_LIST;
+    bool primitiveRestart = false;
+    FILL_MODE fillMode = FILL_SOLID;
 };
 struct GpuTexture_T
 {
@@ -34,6 +52,16 @@ struct GpuTexture_T
     // automatically. Images rest in VK_IMAGE_LAYOUT_GENERAL; only swapchain
     // images move to PRESENT_SRC for presentation.
     VkImageLayout currentLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    // Sub-range views (single mips, layers or cube faces) created on demand by
+    // the view descriptor functions, keyed by their packed range; destroyed
+    // with the texture.
+    std::map<uint64_t, VkImageView> subViews;
+    std::mutex subViewsMutex;
+    // Depth+stencil view of combined formats for render pass attachments;
+    // `view` keeps the single depth aspect descriptors require.
+    VkImageView attachmentView = VK_NULL_HANDLE;
+    // Dedicated memory of USAGE_TRANSIENT textures created without ptrGpu.
+    VkDeviceMemory transientMemory = VK_NULL_HANDLE;
 };
 struct VulkanDevice;
 struct GpuDevice_T
@@ -64,6 +92,7 @@ struct GpuCommandBuffer_T
     VkCommandPool pool = VK_NULL_HANDLE;
     // Recording-local state; a command buffer is owned by one thread at a time.
     GpuPipeline currentPipeline = nullptr;
+    bool skipWork = false; // current pipeline still compiling, no fallback
 };
 struct GpuSemaphore_T
 {
@@ -108,6 +137,10 @@ struct GpuAccelerationStructure_T
     VkAccelerationStructureBuildGeometryInfoKHR buildInfo = {};
     std::vector<VkAccelerationStructureBuildRangeInfoKHR> buildRanges;
     std::vector<VkAccelerationStructureGeometryKHR> geometries;
+    // Scratch requirements queried at creation so batched builds can carve
+    // a disjoint slice of the caller's scratch range for every structure.
+    VkDeviceSize buildScratchSize = 0;
+    VkDeviceSize updateScratchSize = 0;
     GpuDevice device;
 };
 #endif // GPU_RAY_TRACING_EXTENSION
@@ -155,11 +188,149 @@ FORMAT gpuVkFormatToGpuFormat(VkFormat format)
         return FORMAT_RGBA32_FLOAT;
     case VK_FORMAT_R16G16B16A16_SFLOAT:
         return FORMAT_RGBA16_FLOAT;
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return FORMAT_RGBA8_SRGB;
+    case VK_FORMAT_R8_UNORM:
+        return FORMAT_R8_UNORM;
+    case VK_FORMAT_R8G8_UNORM:
+        return FORMAT_RG8_UNORM;
+    case VK_FORMAT_R16_SFLOAT:
+        return FORMAT_R16_FLOAT;
+    case VK_FORMAT_R16G16_SFLOAT:
+        return FORMAT_RG16_FLOAT;
+    case VK_FORMAT_R32_SFLOAT:
+        return FORMAT_R32_FLOAT;
+    case VK_FORMAT_R32_UINT:
+        return FORMAT_R32_UINT;
+    case VK_FORMAT_D16_UNORM:
+        return FORMAT_D16_UNORM;
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+        return FORMAT_D24_UNORM_S8_UINT;
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return FORMAT_D32_FLOAT_S8_UINT;
+    case VK_FORMAT_S8_UINT:
+        return FORMAT_S8_UINT;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        return FORMAT_BC1_RGBA_UNORM;
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        return FORMAT_BC1_RGBA_SRGB;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+        return FORMAT_BC2_UNORM;
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+        return FORMAT_BC2_SRGB;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        return FORMAT_BC3_UNORM;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        return FORMAT_BC3_SRGB;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+        return FORMAT_BC4_UNORM;
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        return FORMAT_BC4_SNORM;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+        return FORMAT_BC5_UNORM;
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+        return FORMAT_BC5_SNORM;
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+        return FORMAT_BC6H_UFLOAT;
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+        return FORMAT_BC6H_SFLOAT;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+        return FORMAT_BC7_UNORM;
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return FORMAT_BC7_SRGB;
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        return FORMAT_ETC2_RGB8_UNORM;
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        return FORMAT_ETC2_RGB8_SRGB;
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        return FORMAT_ETC2_RGBA8_UNORM;
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        return FORMAT_ETC2_RGBA8_SRGB;
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+        return FORMAT_ASTC_4x4_UNORM;
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return FORMAT_ASTC_4x4_SRGB;
+    case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+        return FORMAT_ASTC_6x6_UNORM;
+    case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+        return FORMAT_ASTC_6x6_SRGB;
+    case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+        return FORMAT_ASTC_8x8_UNORM;
+    case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+        return FORMAT_ASTC_8x8_SRGB;
     default:
         return FORMAT_NONE;
     }
 }
 
+VkImageType gpuTextureTypeToVkImageType(TEXTURE type)
+{
+    switch (type)
+    {
+    case TEXTURE_1D:
+        return VK_IMAGE_TYPE_1D;
+    case TEXTURE_3D:
+        return VK_IMAGE_TYPE_3D;
+    case TEXTURE_2D:
+    case TEXTURE_2D_ARRAY:
+    case TEXTURE_CUBE:
+    case TEXTURE_CUBE_ARRAY:
+    default:
+        return VK_IMAGE_TYPE_2D;
+    }
+}
+
+VkImageViewType gpuTextureTypeToVkViewType(TEXTURE type)
+{
+    switch (type)
+    {
+    case TEXTURE_1D:
+        return VK_IMAGE_VIEW_TYPE_1D;
+    case TEXTURE_3D:
+        return VK_IMAGE_VIEW_TYPE_3D;
+    case TEXTURE_2D_ARRAY:
+        return VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    case TEXTURE_CUBE:
+        return VK_IMAGE_VIEW_TYPE_CUBE;
+    case TEXTURE_CUBE_ARRAY:
+        return VK_IMAGE_VIEW_TYPE_CUBE_ARRAY;
+    case TEXTURE_2D:
+    default:
+        return VK_IMAGE_VIEW_TYPE_2D;
+    }
+}
+
+// Vulkan array layers backing a texture. Cube types count whole cubes in
+// GpuTextureDesc::layerCount, so each one is six layers (faces).
+uint32_t gpuTextureLayerCount(const GpuTextureDesc& desc)
+{
+    if (desc.type == TEXTURE_CUBE || desc.type == TEXTURE_CUBE_ARRAY)
+    {
+        return 6 * std::max<uint32_t>(desc.layerCount, 1);
+    }
+    if (desc.type == TEXTURE_3D)
+    {
+        return 1;
+    }
+    return std::max<uint32_t>(desc.layerCount, 1);
+}
+
+// Texel extent of mip 0. Only 3D textures have depth; layers are separate.
+VkExtent3D gpuTextureExtent(const GpuTextureDesc& desc)
+{
+    return {
+        desc.dimensions.x,
+        desc.type == TEXTURE_1D ? 1 : desc.dimensions.y,
+        desc.type == TEXTURE_3D ? desc.dimensions.z : 1
+    };
+}
+
+VkOffset3D gpuTextureExtentOffset(const GpuTextureDesc& desc)
+{
+    VkExtent3D extent = gpuTextureExtent(desc);
+    return { static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), static_cast<int32_t>(extent.depth) };
+}
+
 VkFormat gpuFormatToVkFormat(FORMAT format)
 {
     switch (format)
@@ -182,11 +353,179 @@ VkFormat gpuFormatToVkFormat(FORMAT format)
         return VK_FORMAT_R32G32B32A32_SFLOAT;
     case FORMAT_RGBA16_FLOAT:
         return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case FORMAT_RGBA8_SRGB:
+        return VK_FORMAT_R8G8B8A8_SRGB;
+    case FORMAT_R8_UNORM:
+        return VK_FORMAT_R8_UNORM;
+    case FORMAT_RG8_UNORM:
+        return VK_FORMAT_R8G8_UNORM;
+    case FORMAT_R16_FLOAT:
+        return VK_FORMAT_R16_SFLOAT;
+    case FORMAT_RG16_FLOAT:
+        return VK_FORMAT_R16G16_SFLOAT;
+    case FORMAT_R32_FLOAT:
+        return VK_FORMAT_R32_SFLOAT;
+    case FORMAT_R32_UINT:
+        return VK_FORMAT_R32_UINT;
+    case FORMAT_D16_UNORM:
+        return VK_FORMAT_D16_UNORM;
+    case FORMAT_D24_UNORM_S8_UINT:
+        return VK_FORMAT_D24_UNORM_S8_UINT;
+    case FORMAT_D32_FLOAT_S8_UINT:
+        return VK_FORMAT_D32_SFLOAT_S8_UINT;
+    case FORMAT_S8_UINT:
+        return VK_FORMAT_S8_UINT;
+    case FORMAT_BC1_RGBA_UNORM:
+        return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case FORMAT_BC1_RGBA_SRGB:
+        return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case FORMAT_BC2_UNORM:
+        return VK_FORMAT_BC2_UNORM_BLOCK;
+    case FORMAT_BC2_SRGB:
+        return VK_FORMAT_BC2_SRGB_BLOCK;
+    case FORMAT_BC3_UNORM:
+        return VK_FORMAT_BC3_UNORM_BLOCK;
+    case FORMAT_BC3_SRGB:
+        return VK_FORMAT_BC3_SRGB_BLOCK;
+    case FORMAT_BC4_UNORM:
+        return VK_FORMAT_BC4_UNORM_BLOCK;
+    case FORMAT_BC4_SNORM:
+        return VK_FORMAT_BC4_SNORM_BLOCK;
+    case FORMAT_BC5_UNORM:
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    case FORMAT_BC5_SNORM:
+        return VK_FORMAT_BC5_SNORM_BLOCK;
+    case FORMAT_BC6H_UFLOAT:
+        return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    case FORMAT_BC6H_SFLOAT:
+        return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+    case FORMAT_BC7_UNORM:
+        return VK_FORMAT_BC7_UNORM_BLOCK;
+    case FORMAT_BC7_SRGB:
+        return VK_FORMAT_BC7_SRGB_BLOCK;
+    case FORMAT_ETC2_RGB8_UNORM:
+        return VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+    case FORMAT_ETC2_RGB8_SRGB:
+        return VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK;
+    case FORMAT_ETC2_RGBA8_UNORM:
+        return VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+    case FORMAT_ETC2_RGBA8_SRGB:
+        return VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK;
+    case FORMAT_ASTC_4x4_UNORM:
+        return VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+    case FORMAT_ASTC_4x4_SRGB:
+        return VK_FORMAT_ASTC_4x4_SRGB_BLOCK;
+    case FORMAT_ASTC_6x6_UNORM:
+        return VK_FORMAT_ASTC_6x6_UNORM_BLOCK;
+    case FORMAT_ASTC_6x6_SRGB:
+        return VK_FORMAT_ASTC_6x6_SRGB_BLOCK;
+    case FORMAT_ASTC_8x8_UNORM:
+        return VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
+    case FORMAT_ASTC_8x8_SRGB:
+        return VK_FORMAT_ASTC_8x8_SRGB_BLOCK;
     default:
         return VK_FORMAT_UNDEFINED;
     }
 }
 
+GpuFormatBlock gpuFormatBlock(FORMAT format)
+{
+    switch (format)
+    {
+    case FORMAT_R8_UNORM:
+    case FORMAT_S8_UINT:
+        return { 1, 1, 1 };
+    case FORMAT_RG8_UNORM:
+    case FORMAT_R16_FLOAT:
+    case FORMAT_D16_UNORM:
+        return { 2, 1, 1 };
+    case FORMAT_RGBA8_UNORM:
+    case FORMAT_RGBA8_SRGB:
+    case FORMAT_BGRA8_SRGB:
+    case FORMAT_D32_FLOAT:
+    case FORMAT_RG11B10_FLOAT:
+    case FORMAT_RGB10_A2_UNORM:
+    case FORMAT_RG16_FLOAT:
+    case FORMAT_R32_FLOAT:
+    case FORMAT_R32_UINT:
+    case FORMAT_D24_UNORM_S8_UINT: // depth aspect; the stencil aspect is 1 byte
+    case FORMAT_D32_FLOAT_S8_UINT:
+        return { 4, 1, 1 };
+    case FORMAT_RG32_FLOAT:
+    case FORMAT_RGBA16_FLOAT:
+        return { 8, 1, 1 };
+    case FORMAT_RGB32_FLOAT:
+        return { 12, 1, 1 };
+    case FORMAT_RGBA32_FLOAT:
+        return { 16, 1, 1 };
+    case FORMAT_BC1_RGBA_UNORM:
+    case FORMAT_BC1_RGBA_SRGB:
+    case FORMAT_BC4_UNORM:
+    case FORMAT_BC4_SNORM:
+    case FORMAT_ETC2_RGB8_UNORM:
+    case FORMAT_ETC2_RGB8_SRGB:
+        return { 8, 4, 4 };
+    case FORMAT_BC2_UNORM:
+    case FORMAT_BC2_SRGB:
+    case FORMAT_BC3_UNORM:
+    case FORMAT_BC3_SRGB:
+    case FORMAT_BC5_UNORM:
+    case FORMAT_BC5_SNORM:
+    case FORMAT_BC6H_UFLOAT:
+    case FORMAT_BC6H_SFLOAT:
+    case FORMAT_BC7_UNORM:
+    case FORMAT_BC7_SRGB:
+    case FORMAT_ETC2_RGBA8_UNORM:
+    case FORMAT_ETC2_RGBA8_SRGB:
+    case FORMAT_ASTC_4x4_UNORM:
+    case FORMAT_ASTC_4x4_SRGB:
+        return { 16, 4, 4 };
+    case FORMAT_ASTC_6x6_UNORM:
+    case FORMAT_ASTC_6x6_SRGB:
+        return { 16, 6, 6 };
+    case FORMAT_ASTC_8x8_UNORM:
+    case FORMAT_ASTC_8x8_SRGB:
+        return { 16, 8, 8 };
+    default:
+        return { 0, 1, 1 };
+    }
+}
+
+bool gpuFormatHasDepth(FORMAT format)
+{
+    return format == FORMAT_D16_UNORM || format == FORMAT_D32_FLOAT ||
+           format == FORMAT_D24_UNORM_S8_UINT || format == FORMAT_D32_FLOAT_S8_UINT;
+}
+
+bool gpuFormatHasStencil(FORMAT format)
+{
+    return format == FORMAT_D24_UNORM_S8_UINT || format == FORMAT_D32_FLOAT_S8_UINT || format == FORMAT_S8_UINT;
+}
+
+// Every aspect of the format, as layout transitions of combined depth/stencil
+// images must name both.
+VkImageAspectFlags gpuFormatAspectMask(FORMAT format)
+{
+    if (gpuFormatHasDepth(format) || gpuFormatHasStencil(format))
+    {
+        return (gpuFormatHasDepth(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : 0) |
+               (gpuFormatHasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+    }
+    return VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
+// The single aspect that views and copies address: depth for depth formats
+// (shaders sample depth; stencil is copied separately), stencil for
+// stencil-only formats, color otherwise.
+VkImageAspectFlags gpuFormatPrimaryAspect(FORMAT format)
+{
+    if (gpuFormatHasDepth(format))
+    {
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
+    return gpuFormatHasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
 USAGE_FLAGS gpuVkUsageToGpuUsage(VkImageUsageFlags usage)
 {
     uint32_t result = 0;
@@ -210,6 +549,10 @@ USAGE_FLAGS gpuVkUsageToGpuUsage(VkImageUsageFlags usage)
     {
         result = static_cast<uint32_t>(USAGE_TRANSFER_DST) | result;
     }
+    if (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+    {
+        result = static_cast<uint32_t>(USAGE_TRANSIENT) | result;
+    }
 
     return static_cast<USAGE_FLAGS>(result);
 }
@@ -241,6 +584,10 @@ VkImageUsageFlagBits gpuGpuUsageToVkUsage(USAGE_FLAGS usage)
     {
         result = static_cast<uint32_t>(VK_IMAGE_USAGE_TRANSFER_SRC_BIT) | result;
     }
+    if (usage & USAGE_TRANSIENT)
+    {
+        result = static_cast<uint32_t>(VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) | result;
+    }
 
     return static_cast<VkImageUsageFlagBits>(result);
 }
@@ -326,11 +673,87 @@ VkStencilOp gpuOpToVkStencilOp(OP op)
         return VK_STENCIL_OP_KEEP;
     case OP_ZERO:
         return VK_STENCIL_OP_ZERO;
+    case OP_REPLACE:
+        return VK_STENCIL_OP_REPLACE;
+    case OP_INCREMENT_CLAMP:
+        return VK_STENCIL_OP_INCREMENT_AND_CLAMP;
+    case OP_DECREMENT_CLAMP:
+        return VK_STENCIL_OP_DECREMENT_AND_CLAMP;
+    case OP_INVERT:
+        return VK_STENCIL_OP_INVERT;
+    case OP_INCREMENT_WRAP:
+        return VK_STENCIL_OP_INCREMENT_AND_WRAP;
+    case OP_DECREMENT_WRAP:
+        return VK_STENCIL_OP_DECREMENT_AND_WRAP;
     default:
         return VK_STENCIL_OP_KEEP;
     }
 }
 
+VkResolveModeFlagBits gpuResolveToVkResolveMode(RESOLVE resolve)
+{
+    switch (resolve)
+    {
+    case RESOLVE_AVERAGE:
+        return VK_RESOLVE_MODE_AVERAGE_BIT;
+    case RESOLVE_SAMPLE_ZERO:
+        return VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+    case RESOLVE_MIN:
+        return VK_RESOLVE_MODE_MIN_BIT;
+    case RESOLVE_MAX:
+        return VK_RESOLVE_MODE_MAX_BIT;
+    default:
+        return VK_RESOLVE_MODE_AVERAGE_BIT;
+    }
+}
+
+VkPrimitiveTopology gpuTopologyToVkTopology(TOPOLOGY topology)
+{
+    switch (topology)
+    {
+    case TOPOLOGY_TRIANGLE_LIST:
+        return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    case TOPOLOGY_TRIANGLE_STRIP:
+        return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+    case TOPOLOGY_TRIANGLE_FAN:
+        return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN;
+    case TOPOLOGY_POINT_LIST:
+        return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+    case TOPOLOGY_LINE_LIST:
+        return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+    case TOPOLOGY_LINE_STRIP:
+        return VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+    default:
+        return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    }
+}
+
+VkPolygonMode gpuFillModeToVkPolygonMode(FILL_MODE mode)
+{
+    switch (mode)
+    {
+    case FILL_WIREFRAME:
+        return VK_POLYGON_MODE_LINE;
+    case FILL_POINTS:
+        return VK_POLYGON_MODE_POINT;
+    case FILL_SOLID:
+    default:
+        return VK_POLYGON_MODE_FILL;
+    }
+}
+
+// CULL picks both the winding treated as front-facing and whether back faces
+// are culled.
+VkCullModeFlags gpuCullToVkCullMode(CULL cull)
+{
+    return cull != CULL_NONE ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
+}
+
+VkFrontFace gpuCullToVkFrontFace(CULL cull)
+{
+    return cull == CULL_CW ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
+}
+
 struct Allocation
 {
     VkBuffer buffer = VK_NULL_HANDLE;
@@ -341,6 +764,43 @@ struct Allocation
     VkBufferUsageFlags usage = 0;
 };
 
+// The GpuTextureDesc fields that determine a texture's memory requirements,
+// normalized (extent and layer count as Vulkan sees them) so equivalent
+// descs share one gpuTextureSizeAlign cache entry.
+struct TextureSizeKey
+{
+    uint32_t type;
+    uint32_t width;
+    uint32_t height;
+    uint32_t depth;
+    uint32_t mipCount;
+    uint32_t layerCount;
+    uint32_t sampleCount;
+    uint32_t format;
+    uint32_t usage;
+
+    bool operator==(const TextureSizeKey&) const = default;
+};
+
+struct TextureSizeKeyHash
+{
+    size_t operator()(const TextureSizeKey& key) const
+    {
+        // FNV-1a over the packed fields
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&key);
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < sizeof(TextureSizeKey); i++)
+        {
+            hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+// Resolved static samplers of one SPIR-V module (see StaticSamplerStage),
+// memoized per device by IR hash and verified against the IR bytes.
+struct StaticSamplerModule;
+
 struct VulkanInstance
 {
     vkb::Instance instance;
@@ -478,21 +938,78 @@ struct VulkanDevice
     std::mutex samplerMutex;
     std::mutex poolFreeListMutex;
 
+    // Async pipeline compilation: one worker thread, started by the first
+    // gpuCreate*PipelineAsync, drains pipelineJobs in order.
+    // pipelineJobsMutex guards the queue and the stop flag.
+    std::thread pipelineWorker;
+    std::mutex pipelineJobsMutex;
+    std::condition_variable pipelineJobsCondition;
+    std::deque<std::function<void()>> pipelineJobs;
+    bool pipelineWorkerStop = false;
+
+    void enqueuePipelineJob(std::function<void()> job)
+    {
+        std::lock_guard lock(pipelineJobsMutex);
+        if (!pipelineWorker.joinable())
+        {
+            pipelineWorker = std::thread([this]()
+            {
+                for (;;)
+                {
+                    std::function<void()> next;
+                    {
+                        std::unique_lock lock(pipelineJobsMutex);
+                        pipelineJobsCondition.wait(lock, [this]() { return pipelineWorkerStop || !pipelineJobs.empty(); });
+                        if (pipelineJobs.empty())
+                        {
+                            return;
+                        }
+                        next = std::move(pipelineJobs.front());
+                        pipelineJobs.pop_front();
+                    }
+                    next();
+                }
+            });
+        }
+        pipelineJobs.push_back(std::move(job));
+        pipelineJobsCondition.notify_one();
+    }
+
     // Vulkan structs
     VkPhysicalDeviceMemoryProperties memoryProperties = {};
     VkPhysicalDeviceProperties2 physicalDeviceProperties2 = {};
     VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProperties = {};
+    VkPhysicalDeviceMultiviewProperties multiviewProperties = {};
+    VkPhysicalDeviceDepthStencilResolveProperties depthStencilResolveProperties = {};
+#ifdef GPU_RAY_TRACING_EXTENSION
+    VkPhysicalDeviceAccelerationStructurePropertiesKHR accelerationStructureProperties = {};
+    bool accelerationStructureIndirectBuild = false;
+#endif // GPU_RAY_TRACING_EXTENSION
+    bool dynamicPolygonMode = false; // VK_EXT_extended_dynamic_state3 polygon mode
+    bool wideLines = false;
+    bool multiview = false; // GpuRenderPassDesc::viewMask, SV_ViewID
 
     // Allocation tracking
     std::vector<Allocation> allocations;
     Allocation samplerDescriptors;
 
+    // gpuTextureSizeAlign memo. Loaders query many textures sharing a handful
+    // of shapes; textureSizeMutex is shared for the lookups that dominate.
+    std::unordered_map<TextureSizeKey, GpuTextureMemoryRequirements, TextureSizeKeyHash> textureSizes;
+    std::shared_mutex textureSizeMutex;
+
     // Static samplers (STATIC_SAMPLER in Sampler.h): hardware samplers created
     // on demand at pipeline creation, deduplicated by packed state. Slot 0 is
     // the default sampler.
     std::map<uint64_t, uint32_t> staticSamplerSlots; // packed state -> heap slot
     std::vector<VkSampler> staticSamplers;
     uint32_t nextSamplerSlot = 1;
+    // Scan + patch results keyed by IR hash, so pipelines sharing a module
+    // (entry points of one .spv, batch creation) skip the SPIR-V walk. Capped
+    // at STATIC_SAMPLER_MODULE_LIMIT entries; in-flight builds hold their own
+    // reference, so dropping the map never frees a module in use.
+    std::unordered_map<uint64_t, std::shared_ptr<const StaticSamplerModule>> staticSamplerModules;
+    std::shared_mutex staticSamplerModulesMutex;
 
     // Buffer descriptor sets
     VkDeviceSize descriptorSetLayoutSize = 0;
@@ -550,11 +1067,18 @@ struct VulkanDevice
         descriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
         descriptorBufferFeatures.descriptorBuffer = VK_TRUE;
 
+        VkPhysicalDeviceVulkan14Features physicalDeviceVulkan14Features = {};
+        physicalDeviceVulkan14Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES;
+        physicalDeviceVulkan14Features.maintenance5 = VK_TRUE; // SPIR-V chained into pipeline stages, no VkShaderModule
+
         VkPhysicalDeviceVulkan13Features physicalDeviceVulkan13Features = {};
         physicalDeviceVulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
         physicalDeviceVulkan13Features.synchronization2 = VK_TRUE;
         physicalDeviceVulkan13Features.dynamicRendering = VK_TRUE;
 
+        VkPhysicalDeviceVulkan11Features physicalDeviceVulkan11Features = {};
+        physicalDeviceVulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+
         VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features = {};
         physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
         physicalDeviceVulkan12Features.timelineSemaphore = VK_TRUE;
@@ -568,21 +1092,97 @@ struct VulkanDevice
 
         vulkanDevice->physicalDevice.features.shaderInt64 = VK_TRUE;
         vulkanDevice->physicalDevice.features.samplerAnisotropy = VK_TRUE; // static samplers can request anisotropy
+        vulkanDevice->physicalDevice.features.imageCubeArray = VK_TRUE;    // TEXTURE_CUBE_ARRAY views
 
+        // Optional features are enabled only where the device reports them;
+        // callers probe the result through gpuFormatSupported and friends.
+        VkPhysicalDeviceFeatures2 supportedFeatures = {};
+        supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
 #ifdef GPU_RAY_TRACING_EXTENSION
+        VkPhysicalDeviceAccelerationStructureFeaturesKHR supportedAccelerationStructureFeatures = {};
+        supportedAccelerationStructureFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+        supportedFeatures.pNext = &supportedAccelerationStructureFeatures;
+#endif // GPU_RAY_TRACING_EXTENSION
+        VkPhysicalDeviceExtendedDynamicState3FeaturesEXT supportedDynamicState3Features = {};
+        supportedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+        const bool dynamicState3 = vulkanDevice->physicalDevice.is_extension_present(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+        if (dynamicState3)
+        {
+            supportedDynamicState3Features.pNext = supportedFeatures.pNext;
+            supportedFeatures.pNext = &supportedDynamicState3Features;
+        }
+        VkPhysicalDeviceVulkan12Features supportedVulkan12Features = {};
+        supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        supportedVulkan12Features.pNext = supportedFeatures.pNext;
+        supportedFeatures.pNext = &supportedVulkan12Features;
+        VkPhysicalDeviceVulkan11Features supportedVulkan11Features = {};
+        supportedVulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+        supportedVulkan11Features.pNext = supportedFeatures.pNext;
+        supportedFeatures.pNext = &supportedVulkan11Features;
+        vulkanInstance->instanceDispatchTable.getPhysicalDeviceFeatures2(vulkanDevice->physicalDevice, &supportedFeatures);
+
+        // Non-solid fill modes and wide lines (gpuSetFillMode, gpuSetLineWidth)
+        vulkanDevice->physicalDevice.features.fillModeNonSolid = supportedFeatures.features.fillModeNonSolid;
+        vulkanDevice->physicalDevice.features.wideLines = supportedFeatures.features.wideLines;
+        vulkanDevice->wideLines = supportedFeatures.features.wideLines == VK_TRUE;
+
+        // Multiview passes (GpuRenderPassDesc::viewMask, SV_ViewID); see gpuMaxViewCount
+        physicalDeviceVulkan11Features.multiview = supportedVulkan11Features.multiview;
+        vulkanDevice->multiview = supportedVulkan11Features.multiview == VK_TRUE;
+
+        // SV_RenderTargetArrayIndex from vertex/mesh stages (layered passes)
+        physicalDeviceVulkan12Features.shaderOutputLayer = supportedVulkan12Features.shaderOutputLayer;
+
+        VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features = {};
+        dynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+        if (dynamicState3 && supportedDynamicState3Features.extendedDynamicState3PolygonMode)
+        {
+            vulkanDevice->physicalDevice.enable_extension_if_present(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+            dynamicState3Features.extendedDynamicState3PolygonMode = VK_TRUE;
+            vulkanDevice->dynamicPolygonMode = true;
+        }
+
+        // Block-compressed formats (FORMAT_BC*, FORMAT_ETC2_*, FORMAT_ASTC_*)
+        vulkanDevice->physicalDevice.features.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+        vulkanDevice->physicalDevice.features.textureCompressionETC2 = supportedFeatures.features.textureCompressionETC2;
+        vulkanDevice->physicalDevice.features.textureCompressionASTC_LDR = supportedFeatures.features.textureCompressionASTC_LDR;
+
+#ifdef GPU_RAY_TRACING_EXTENSION
+        // Indirect AS builds are optional (most desktop drivers lack them);
+        // gpuBuildAccelerationStructuresIndirect falls back to direct builds.
+        // NGAPI_NO_INDIRECT_AS_BUILD (documented with the other environment
+        // switches in NoGraphicsAPI_Impl.h) forces the fallback, so tests can
+        // cover both paths on one device.
+        const bool indirectBuild = supportedAccelerationStructureFeatures.accelerationStructureIndirectBuild == VK_TRUE && std::getenv("NGAPI_NO_INDIRECT_AS_BUILD") == nullptr;
+        accelerationStructureFeatures.accelerationStructureIndirectBuild = indirectBuild;
+        vulkanDevice->accelerationStructureIndirectBuild = indirectBuild;
 #endif // GPU_RAY_TRACING_EXTENSION
         vulkanInstance->instanceDispatchTable.getPhysicalDeviceMemoryProperties(vulkanDevice->physicalDevice, &vulkanDevice->memoryProperties);
 
         vulkanDevice->descriptorBufferProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
         vulkanDevice->physicalDeviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
-        vulkanDevice->physicalDeviceProperties2.pNext = &vulkanDevice->descriptorBufferProperties;
+        vulkanDevice->physicalDeviceProperties2.pNext = &vulkanDevice->multiviewProperties;
+        vulkanDevice->multiviewProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MULTIVIEW_PROPERTIES;
+        vulkanDevice->multiviewProperties.pNext = &vulkanDevice->depthStencilResolveProperties;
+        vulkanDevice->depthStencilResolveProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEPTH_STENCIL_RESOLVE_PROPERTIES;
+        vulkanDevice->depthStencilResolveProperties.pNext = &vulkanDevice->descriptorBufferProperties;
+#ifdef GPU_RAY_TRACING_EXTENSION
+        vulkanDevice->accelerationStructureProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
+        vulkanDevice->descriptorBufferProperties.pNext = &vulkanDevice->accelerationStructureProperties;
+#endif // GPU_RAY_TRACING_EXTENSION
         vulkanInstance->instanceDispatchTable.getPhysicalDeviceProperties2(vulkanDevice->physicalDevice, &vulkanDevice->physicalDeviceProperties2);
 
         vkb::DeviceBuilder deviceBuilder{ vulkanDevice->physicalDevice };
         deviceBuilder
+            .add_pNext(&physicalDeviceVulkan11Features)
             .add_pNext(&physicalDeviceVulkan12Features)
             .add_pNext(&physicalDeviceVulkan13Features)
+            .add_pNext(&physicalDeviceVulkan14Features)
             .add_pNext(&descriptorBufferFeatures);
+        if (vulkanDevice->dynamicPolygonMode)
+        {
+            deviceBuilder.add_pNext(&dynamicState3Features);
+        }
 #ifdef GPU_RAY_TRACING_EXTENSION
         deviceBuilder
             .add_pNext(&rayQueryFeatures)
@@ -618,6 +1218,17 @@ struct VulkanDevice
 
     ~VulkanDevice()
     {
+        // Finish queued async compiles; their handles still own the pipelines.
+        {
+            std::lock_guard lock(pipelineJobsMutex);
+            pipelineWorkerStop = true;
+        }
+        pipelineJobsCondition.notify_one();
+        if (pipelineWorker.joinable())
+        {
+            pipelineWorker.join();
+        }
+
         dispatchTable.deviceWaitIdle();
 
         for (auto& [key, pools] : submittedCommandPools)
@@ -804,26 +1415,30 @@ struct VulkanDevice
         return alloc;
     }
 
-    VkImage createImage(GpuTextureDesc desc)
+    static VkImageCreateInfo imageCreateInfo(GpuTextureDesc desc)
     {
         VkImageCreateInfo imageInfo = {};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        imageInfo.imageType = desc.type == TEXTURE_1D ? VK_IMAGE_TYPE_1D : desc.type == TEXTURE_2D ? VK_IMAGE_TYPE_2D
-                                                                       : desc.type == TEXTURE_3D   ? VK_IMAGE_TYPE_3D
-                                                                                                   : VK_IMAGE_TYPE_MAX_ENUM;
-        imageInfo.extent.width = desc.dimensions.x;
-        imageInfo.extent.height = desc.dimensions.y;
-        imageInfo.extent.depth = desc.dimensions.z;
+        imageInfo.imageType = gpuTextureTypeToVkImageType(desc.type);
+        if (desc.type == TEXTURE_CUBE || desc.type == TEXTURE_CUBE_ARRAY)
+        {
+            imageInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        }
+        imageInfo.extent = gpuTextureExtent(desc);
         imageInfo.mipLevels = desc.mipCount;
-        imageInfo.arrayLayers = desc.layerCount;
+        imageInfo.arrayLayers = gpuTextureLayerCount(desc);
         imageInfo.samples = static_cast<VkSampleCountFlagBits>(desc.sampleCount);
         imageInfo.format = gpuFormatToVkFormat(desc.format);
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.usage = gpuGpuUsageToVkUsage(desc.usage);
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        return imageInfo;
+    }
 
-        VkMemoryRequirements imageMemoryRequirements = {};
+    VkImage createImage(GpuTextureDesc desc)
+    {
+        VkImageCreateInfo imageInfo = imageCreateInfo(desc);
 
         VkImage image;
         dispatchTable.createImage(&imageInfo, nullptr, &image);
@@ -831,6 +1446,45 @@ struct VulkanDevice
         return image;
     }
 
+    // Lazily allocated memory is only committed if the attachment spills out
+    // of tile memory; desktop GPUs have no such type and get device-local.
+    // Returns VK_NULL_HANDLE (after reporting why) if the image can't be backed.
+    VkDeviceMemory allocateTransientMemory(VkImage image)
+    {
+        VkMemoryRequirements memRequirements = {};
+        dispatchTable.getImageMemoryRequirements(image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+        if (allocInfo.memoryTypeIndex == UINT32_MAX)
+        {
+            allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        if (allocInfo.memoryTypeIndex == UINT32_MAX)
+        {
+            fprintf(stderr, "NoGraphicsAPI: no device-local memory type for a transient texture\n");
+            return VK_NULL_HANDLE;
+        }
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkResult result = dispatchTable.allocateMemory(&allocInfo, nullptr, &memory);
+        if (result != VK_SUCCESS)
+        {
+            fprintf(stderr, "NoGraphicsAPI: vkAllocateMemory failed for a transient texture (VkResult %d)\n", result);
+            return VK_NULL_HANDLE;
+        }
+        result = dispatchTable.bindImageMemory(image, memory, 0);
+        if (result != VK_SUCCESS)
+        {
+            fprintf(stderr, "NoGraphicsAPI: vkBindImageMemory failed for a transient texture (VkResult %d)\n", result);
+            dispatchTable.freeMemory(memory, nullptr);
+            return VK_NULL_HANDLE;
+        }
+        return memory;
+    }
+
     void createPipelineLayout()
     {
         VkDescriptorSetLayoutBinding textureBinding = {};
@@ -1216,16 +1870,111 @@ void* gpuHostToDevicePointer(GpuDevice device, void* ptr)
     return nullptr;
 }
 
-GpuTextureSizeAlign gpuTextureSizeAlign(GpuDevice device, GpuTextureDesc desc)
+uint32_t gpuMaxViewCount(GpuDevice device)
 {
     VulkanDevice* vulkanDevice = device->vulkanDevice;
-    VkImage image = vulkanDevice->createImage(desc);
+    return vulkanDevice->multiview ? vulkanDevice->multiviewProperties.maxMultiviewViewCount : 0;
+}
+
+bool gpuFormatSupported(GpuDevice device, FORMAT format, USAGE_FLAGS usage)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    VkFormat vkFormat = gpuFormatToVkFormat(format);
+    if (vkFormat == VK_FORMAT_UNDEFINED)
+    {
+        return false;
+    }
+
+    VkFormatProperties properties = {};
+    vulkanDevice->inst->instanceDispatchTable.getPhysicalDeviceFormatProperties(vulkanDevice->physicalDevice, vkFormat, &properties);
+
+    VkFormatFeatureFlags required = 0;
+    if (usage & USAGE_SAMPLED)
+    {
+        required |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    }
+    if (usage & USAGE_STORAGE)
+    {
+        required |= VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+    }
+    if (usage & USAGE_COLOR_ATTACHMENT)
+    {
+        required |= VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+    }
+    if (usage & USAGE_DEPTH_STENCIL_ATTACHMENT)
+    {
+        required |= VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    }
+    if (usage & USAGE_TRANSFER_DST)
+    {
+        required |= VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    }
+    if (usage & USAGE_TRANSFER_SRC)
+    {
+        required |= VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+    }
+
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+// Memoized per device. Misses ask the driver through
+// vkGetDeviceImageMemoryRequirements (core 1.3), which needs no VkImage.
+GpuTextureMemoryRequirements gpuTextureMemoryRequirements(GpuDevice device, GpuTextureDesc desc)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    VkExtent3D extent = gpuTextureExtent(desc);
+    TextureSizeKey key = {
+        static_cast<uint32_t>(desc.type),
+        extent.width,
+        extent.height,
+        extent.depth,
+        desc.mipCount,
+        gpuTextureLayerCount(desc),
+        desc.sampleCount,
+        static_cast<uint32_t>(desc.format),
+        static_cast<uint32_t>(desc.usage)
+    };
+
+    {
+        std::shared_lock lock(vulkanDevice->textureSizeMutex);
+        auto it = vulkanDevice->textureSizes.find(key);
+        if (it != vulkanDevice->textureSizes.end())
+        {
+            return it->second;
+        }
+    }
+
+    VkImageCreateInfo imageInfo = VulkanDevice::imageCreateInfo(desc);
+    VkDeviceImageMemoryRequirements requirementsInfo = {};
+    requirementsInfo.sType = VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS;
+    requirementsInfo.pCreateInfo = &imageInfo;
+
+    VkMemoryRequirements2 memoryRequirements = {};
+    memoryRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    vulkanDevice->dispatchTable.getDeviceImageMemoryRequirements(&requirementsInfo, &memoryRequirements);
 
-    VkMemoryRequirements imageMemoryRequirements = {};
-    vulkanDevice->dispatchTable.getImageMemoryRequirements(image, &imageMemoryRequirements);
+    const VkMemoryRequirements& requirements = memoryRequirements.memoryRequirements;
+    GpuTextureMemoryRequirements result = { requirements.size, requirements.alignment, requirements.memoryTypeBits };
+
+    std::unique_lock lock(vulkanDevice->textureSizeMutex);
+    vulkanDevice->textureSizes.emplace(key, result);
+    return result;
+}
+
+GpuTextureMemoryRequirements gpuTextureMemoryRequirementsFromImage(GpuDevice device, GpuTextureDesc desc)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    VkImage image = vulkanDevice->createImage(desc);
+    VkMemoryRequirements requirements = {};
+    vulkanDevice->dispatchTable.getImageMemoryRequirements(image, &requirements);
     vulkanDevice->dispatchTable.destroyImage(image, nullptr);
+    return { requirements.size, requirements.alignment, requirements.memoryTypeBits };
+}
 
-    return { imageMemoryRequirements.size, imageMemoryRequirements.alignment };
+GpuTextureSizeAlign gpuTextureSizeAlign(GpuDevice device, GpuTextureDesc desc)
+{
+    GpuTextureMemoryRequirements requirements = gpuTextureMemoryRequirements(device, desc);
+    return { requirements.size, requirements.align };
 }
 
 // Records an image layout transition. Images are never used in UNDEFINED on
@@ -1246,7 +1995,7 @@ static void transitionImageLayout(VulkanDevice* vulkanDevice, VkCommandBuffer cb
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = texture->image;
-    barrier.subresourceRange.aspectMask = (texture->desc.usage & USAGE_DEPTH_STENCIL_ATTACHMENT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.aspectMask = gpuFormatAspectMask(texture->desc.format);
     barrier.subresourceRange.baseMipLevel = 0;
     barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
     barrier.subresourceRange.baseArrayLayer = 0;
@@ -1269,30 +2018,48 @@ static void transitionImageLayout(VulkanDevice* vulkanDevice, VkCommandBuffer cb
 GpuTexture gpuCreateTexture(GpuDevice device, GpuTextureDesc desc, void* ptrGpu)
 {
     VulkanDevice* vulkanDevice = device->vulkanDevice;
-    Allocation alloc = vulkanDevice->findAllocation(reinterpret_cast<VkDeviceAddress>(ptrGpu));
-
     VkImage image = vulkanDevice->createImage(desc);
 
-    VkDeviceSize offset = reinterpret_cast<VkDeviceAddress>(ptrGpu) - alloc.address;
-    vulkanDevice->dispatchTable.bindImageMemory(image, alloc.memory, offset);
+    VkDeviceMemory transientMemory = VK_NULL_HANDLE;
+    if (ptrGpu == nullptr)
+    {
+        assert(desc.usage & USAGE_TRANSIENT);
+        transientMemory = vulkanDevice->allocateTransientMemory(image);
+        if (transientMemory == VK_NULL_HANDLE)
+        {
+            vulkanDevice->dispatchTable.destroyImage(image, nullptr);
+            return nullptr;
+        }
+    }
+    else
+    {
+        Allocation alloc = vulkanDevice->findAllocation(reinterpret_cast<VkDeviceAddress>(ptrGpu));
+        VkDeviceSize offset = reinterpret_cast<VkDeviceAddress>(ptrGpu) - alloc.address;
+        vulkanDevice->dispatchTable.bindImageMemory(image, alloc.memory, offset);
+    }
 
     VkImageViewCreateInfo viewInfo = {};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
-    viewInfo.viewType = desc.type == TEXTURE_1D ? VK_IMAGE_VIEW_TYPE_1D : desc.type == TEXTURE_2D ? VK_IMAGE_VIEW_TYPE_2D
-                                                                      : desc.type == TEXTURE_3D   ? VK_IMAGE_VIEW_TYPE_3D
-                                                                                                  : VK_IMAGE_VIEW_TYPE_MAX_ENUM;
+    viewInfo.viewType = gpuTextureTypeToVkViewType(desc.type);
     viewInfo.format = gpuFormatToVkFormat(desc.format);
-    viewInfo.subresourceRange.aspectMask = (desc.usage & USAGE_DEPTH_STENCIL_ATTACHMENT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.aspectMask = gpuFormatPrimaryAspect(desc.format);
     viewInfo.subresourceRange.baseMipLevel = 0;
     viewInfo.subresourceRange.levelCount = desc.mipCount;
     viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = desc.layerCount;
+    viewInfo.subresourceRange.layerCount = gpuTextureLayerCount(desc);
 
     VkImageView imageView = VK_NULL_HANDLE;
     vulkanDevice->dispatchTable.createImageView(&viewInfo, nullptr, &imageView);
 
     GpuTexture texture = new GpuTexture_T{ desc, image, imageView, device };
+    texture->transientMemory = transientMemory;
+
+    if (gpuFormatHasDepth(desc.format) && gpuFormatHasStencil(desc.format))
+    {
+        viewInfo.subresourceRange.aspectMask = gpuFormatAspectMask(desc.format);
+        vulkanDevice->dispatchTable.createImageView(&viewInfo, nullptr, &texture->attachmentView);
+    }
 
     // Move the image out of UNDEFINED into its resting layout (GENERAL) right
     // away with a one-shot submit. Leaving it UNDEFINED until first use causes a
@@ -1356,17 +2123,94 @@ void gpuDestroyTexture(GpuTexture texture)
     }
 
     VulkanDevice* vulkanDevice = texture->device->vulkanDevice;
+    for (auto& [key, view] : texture->subViews)
+    {
+        vulkanDevice->dispatchTable.destroyImageView(view, nullptr);
+    }
+    if (texture->attachmentView != VK_NULL_HANDLE)
+    {
+        vulkanDevice->dispatchTable.destroyImageView(texture->attachmentView, nullptr);
+    }
     vulkanDevice->dispatchTable.destroyImageView(texture->view, nullptr);
     vulkanDevice->dispatchTable.destroyImage(texture->image, nullptr);
+    if (texture->transientMemory != VK_NULL_HANDLE)
+    {
+        vulkanDevice->dispatchTable.freeMemory(texture->transientMemory, nullptr);
+    }
     delete texture;
 }
 
+// Resolves a GpuViewDesc to an image view. The full-resource view made at
+// creation is reused when the desc covers every mip and layer; otherwise a
+// sub-range view is created once per range and kept until the texture is
+// destroyed. A single layer is viewed as 2D (e.g. one cascade or cube face,
+// the usual render or storage target); six-aligned cube ranges keep the cube
+// view type for sampling, and storage views never use cube types. Images are
+// not created MUTABLE_FORMAT, so the view format must be the texture's.
+static VkImageView textureViewForDesc(VulkanDevice* vulkanDevice, GpuTexture texture, GpuViewDesc desc, bool storage)
+{
+    const GpuTextureDesc& textureDesc = texture->desc;
+    const uint32_t textureLayers = gpuTextureLayerCount(textureDesc);
+    const uint32_t baseMip = desc.baseMip;
+    const uint32_t mipCount = desc.mipCount == ALL_MIPS ? textureDesc.mipCount - baseMip : desc.mipCount;
+    const uint32_t baseLayer = desc.baseLayer;
+    const uint32_t layerCount = desc.layerCount == ALL_LAYERS ? textureLayers - baseLayer : desc.layerCount;
+    const FORMAT format = textureDesc.format;
+    assert(desc.format == FORMAT_NONE || desc.format == format);
+
+    const bool cube = textureDesc.type == TEXTURE_CUBE || textureDesc.type == TEXTURE_CUBE_ARRAY;
+    const bool wholeResource = baseMip == 0 && mipCount == textureDesc.mipCount && baseLayer == 0 && layerCount == textureLayers;
+    if (wholeResource && !(storage && cube))
+    {
+        return texture->view;
+    }
+
+    // layer counts fit 16 bits like GpuViewDesc's
+    const uint64_t key = uint64_t(baseMip) | uint64_t(mipCount) << 8 | uint64_t(baseLayer) << 16 | uint64_t(layerCount) << 32 | uint64_t(storage) << 48;
+    std::lock_guard lock(texture->subViewsMutex);
+    auto cached = texture->subViews.find(key);
+    if (cached != texture->subViews.end())
+    {
+        return cached->second;
+    }
+
+    VkImageViewType viewType = gpuTextureTypeToVkViewType(textureDesc.type);
+    if (textureDesc.type != TEXTURE_1D && textureDesc.type != TEXTURE_3D)
+    {
+        if (cube && !storage && layerCount % 6 == 0 && baseLayer % 6 == 0)
+        {
+            viewType = layerCount == 6 && textureDesc.type == TEXTURE_CUBE ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_CUBE_ARRAY;
+        }
+        else
+        {
+            viewType = layerCount == 1 ? VK_IMAGE_VIEW_TYPE_2D : VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        }
+    }
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture->image;
+    viewInfo.viewType = viewType;
+    viewInfo.format = gpuFormatToVkFormat(format);
+    viewInfo.subresourceRange.aspectMask = gpuFormatPrimaryAspect(format);
+    viewInfo.subresourceRange.baseMipLevel = baseMip;
+    viewInfo.subresourceRange.levelCount = mipCount;
+    viewInfo.subresourceRange.baseArrayLayer = baseLayer;
+    viewInfo.subresourceRange.layerCount = layerCount;
+
+    VkImageView view = VK_NULL_HANDLE;
+    vulkanDevice->dispatchTable.createImageView(&viewInfo, nullptr, &view);
+
+    texture->subViews[key] = view;
+    return view;
+}
+
 GpuTextureDescriptor gpuTextureViewDescriptor(GpuTexture texture, GpuViewDesc desc)
 {
     VulkanDevice* vulkanDevice = texture->device->vulkanDevice;
     VkDescriptorImageInfo imageInfo = {};
     imageInfo.sampler = vulkanDevice->defaultSampler;
-    imageInfo.imageView = texture->view;
+    imageInfo.imageView = textureViewForDesc(vulkanDevice, texture, desc, false);
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
     VkDescriptorGetInfoEXT descriptorGetInfo = {};
@@ -1402,7 +2246,7 @@ GpuTextureDescriptor gpuRWTextureViewDescriptor(GpuTexture texture, GpuViewDesc
     VulkanDevice* vulkanDevice = texture->device->vulkanDevice;
     VkDescriptorImageInfo imageInfo = {};
     imageInfo.sampler = VK_NULL_HANDLE;
-    imageInfo.imageView = texture->view;
+    imageInfo.imageView = textureViewForDesc(vulkanDevice, texture, desc, true);
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
     VkDescriptorGetInfoEXT descriptorGetInfo = {};
@@ -1459,7 +2303,8 @@ void ensureSamplerHeap(VulkanDevice* vulkanDevice)
 // Scans SPIR-V for sampler declarations (see Sampler.h): 64-bit specialization
 // constants whose default carries STATIC_SAMPLER_MAGIC, and 32-bit literals
 // carrying INLINE_SAMPLER_MAGIC. Types and decorations precede constants in a
-// valid module, so one pass is enough.
+// valid module, so one pass is enough; per-id facts live in flat arrays sized
+// by the header's id bound.
 struct StaticSamplerRequests
 {
     std::vector<std::pair<uint32_t, uint64_t>> spec;         // SpecId -> packed 48-bit state
@@ -1476,8 +2321,10 @@ StaticSamplerRequests findStaticSamplerRequests(ByteSpan ir)
         return requests;
     }
 
-    std::map<uint32_t, uint32_t> specIds;       // result id -> SpecId
-    std::map<uint32_t, uint32_t> unsignedWidth; // type id -> integer width (unsigned types only)
+    constexpr uint32_t NO_SPEC_ID = ~0u;
+    const uint32_t bound = words[3];
+    std::vector<uint32_t> specIds(bound, NO_SPEC_ID); // result id -> SpecId
+    std::vector<uint8_t> unsignedWidth(bound, 0);     // type id -> integer width (unsigned types only)
     for (size_t at = 5; at < wordCount;)
     {
         const uint32_t length = words[at] >> 16;
@@ -1488,24 +2335,24 @@ StaticSamplerRequests findStaticSamplerRequests(ByteSpan ir)
         }
 
         constexpr uint32_t OpTypeInt = 21, OpConstant = 43, OpSpecConstant = 50, OpDecorate = 71, DecorationSpecId = 1;
-        if (opcode == OpTypeInt && length == 4 && words[at + 3] == 0)
+        if (opcode == OpTypeInt && length == 4 && words[at + 3] == 0 && words[at + 1] < bound)
         {
-            unsignedWidth[words[at + 1]] = words[at + 2];
+            unsignedWidth[words[at + 1]] = static_cast<uint8_t>(words[at + 2]);
         }
-        else if (opcode == OpDecorate && length == 4 && words[at + 2] == DecorationSpecId)
+        else if (opcode == OpDecorate && length == 4 && words[at + 2] == DecorationSpecId && words[at + 1] < bound)
         {
             specIds[words[at + 1]] = words[at + 3];
         }
-        else if (opcode == OpSpecConstant && length == 5 && unsignedWidth[words[at + 1]] == 64)
+        else if (opcode == OpSpecConstant && length == 5 && words[at + 1] < bound && words[at + 2] < bound && unsignedWidth[words[at + 1]] == 64)
         {
             const uint64_t value = words[at + 3] | (static_cast<uint64_t>(words[at + 4]) << 32);
-            auto specId = specIds.find(words[at + 2]);
-            if (specId != specIds.end() && (value & STATIC_SAMPLER_MAGIC_MASK) == STATIC_SAMPLER_MAGIC)
+            const uint32_t specId = specIds[words[at + 2]];
+            if (specId != NO_SPEC_ID && (value & STATIC_SAMPLER_MAGIC_MASK) == STATIC_SAMPLER_MAGIC)
             {
-                requests.spec.push_back({ specId->second, value & ~STATIC_SAMPLER_MAGIC_MASK });
+                requests.spec.push_back({ specId, value & ~STATIC_SAMPLER_MAGIC_MASK });
             }
         }
-        else if (opcode == OpConstant && length == 4 && unsignedWidth[words[at + 1]] == 32)
+        else if (opcode == OpConstant && length == 4 && words[at + 1] < bound && unsignedWidth[words[at + 1]] == 32)
         {
             const uint32_t value = words[at + 3];
             if ((value & INLINE_SAMPLER_MAGIC_MASK) == INLINE_SAMPLER_MAGIC)
@@ -1598,81 +2445,247 @@ uint32_t staticSamplerSlot(VulkanDevice* vulkanDevice, uint64_t packedState)
     return slot;
 }
 
-// Per-stage sampler resolution: STATIC_SAMPLER spec constants get a
-// VkSpecializationInfo mapping them to their heap slots; INLINE_SAMPLER
-// literals are patched in a copy of the IR. Must stay alive until the
-// pipeline is created.
-struct StaticSamplerStage
+struct StaticSamplerModule
 {
+    std::vector<uint8_t> ir; // the IR this was resolved from, compared on every hit
     std::vector<VkSpecializationMapEntry> entries;
     std::vector<uint64_t> slots;
-    VkSpecializationInfo info = {};
-    std::vector<uint8_t> patchedIR;
+    std::vector<uint8_t> patchedIR; // empty when the module has no inline samplers
+};
 
-    // Returns the IR to create the shader module from and sets *specInfo for
-    // the stage (or nullptr).
-    ByteSpan prepare(VulkanDevice* vulkanDevice, ByteSpan ir, const VkSpecializationInfo** specInfo)
+// Most programs have a few dozen shader modules; past this many the memo is
+// dropped and refilled rather than grown without bound.
+constexpr size_t STATIC_SAMPLER_MODULE_LIMIT = 256;
+
+// FNV-1a over the IR's words, seeded with its size.
+static uint64_t hashIR(ByteSpan ir)
+{
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(ir.data());
+    const size_t wordCount = ir.size() / sizeof(uint32_t);
+    uint64_t hash = (0xcbf29ce484222325ull ^ ir.size()) * 0x100000001b3ull;
+    for (size_t i = 0; i < wordCount; i++)
     {
-        auto requests = findStaticSamplerRequests(ir);
+        hash = (hash ^ words[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
 
-        for (auto& [specId, packedState] : requests.spec)
-        {
-            entries.push_back({ specId, static_cast<uint32_t>(slots.size() * sizeof(uint64_t)), sizeof(uint64_t) });
-            slots.push_back(staticSamplerSlot(vulkanDevice, packedState));
-        }
-        *specInfo = nullptr;
-        if (!entries.empty())
-        {
-            info.mapEntryCount = static_cast<uint32_t>(entries.size());
-            info.pMapEntries = entries.data();
-            info.dataSize = slots.size() * sizeof(uint64_t);
-            info.pData = slots.data();
-            *specInfo = &info;
-        }
+// Scans the IR and resolves every sampler it declares to a heap slot. Slots
+// are stable for the device's lifetime, so the result is shared by every
+// pipeline built from the same IR.
+static std::shared_ptr<const StaticSamplerModule> staticSamplerModule(VulkanDevice* vulkanDevice, ByteSpan ir)
+{
+    auto sameIR = [&](const StaticSamplerModule& module)
+    {
+        return module.ir.size() == ir.size() && memcmp(module.ir.data(), ir.data(), ir.size()) == 0;
+    };
 
-        if (requests.inlineLiterals.empty())
+    const uint64_t key = hashIR(ir);
+    {
+        std::shared_lock lock(vulkanDevice->staticSamplerModulesMutex);
+        auto it = vulkanDevice->staticSamplerModules.find(key);
+        if (it != vulkanDevice->staticSamplerModules.end() && sameIR(*it->second))
         {
-            return ir;
+            return it->second;
         }
-        patchedIR.assign(ir.data(), ir.data() + ir.size());
-        uint32_t* words = reinterpret_cast<uint32_t*>(patchedIR.data());
+    }
+
+    auto module = std::make_shared<StaticSamplerModule>();
+    module->ir.assign(ir.data(), ir.data() + ir.size());
+    auto requests = findStaticSamplerRequests(ir);
+    for (auto& [specId, packedState] : requests.spec)
+    {
+        module->entries.push_back({ specId, static_cast<uint32_t>(module->slots.size() * sizeof(uint64_t)), sizeof(uint64_t) });
+        module->slots.push_back(staticSamplerSlot(vulkanDevice, packedState));
+    }
+    if (!requests.inlineLiterals.empty())
+    {
+        module->patchedIR.assign(ir.data(), ir.data() + ir.size());
+        uint32_t* words = reinterpret_cast<uint32_t*>(module->patchedIR.data());
         for (auto& [wordIndex, packedState] : requests.inlineLiterals)
         {
             words[wordIndex] = staticSamplerSlot(vulkanDevice, packedState);
         }
-        return ByteSpan(patchedIR.data(), patchedIR.size());
+    }
+
+    std::unique_lock lock(vulkanDevice->staticSamplerModulesMutex);
+    auto& modules = vulkanDevice->staticSamplerModules;
+    auto it = modules.find(key);
+    if (it != modules.end())
+    {
+        // A racing thread resolved the same IR (either result is valid), or a
+        // different IR collided on the hash and keeps the slot.
+        return sameIR(*it->second) ? it->second : module;
+    }
+    if (modules.size() >= STATIC_SAMPLER_MODULE_LIMIT)
+    {
+        modules.clear();
+    }
+    return modules.emplace(key, std::move(module)).first->second;
+}
+
+// Per-stage sampler resolution: STATIC_SAMPLER spec constants get a
+// VkSpecializationInfo mapping them to their heap slots; INLINE_SAMPLER
+// literals are patched in a copy of the IR. Both come from the device's
+// StaticSamplerModule memo; this keeps it alive until the pipeline is created.
+// User specialization constants are appended after the sampler entries.
+struct StaticSamplerStage
+{
+    std::shared_ptr<const StaticSamplerModule> module;
+    std::vector<VkSpecializationMapEntry> entries; // sampler + user, only when user constants are given
+    std::vector<uint64_t> data;
+    VkSpecializationInfo info = {};
+
+    // Returns the IR to create the shader module from and sets *specInfo for
+    // the stage (or nullptr). The IR stays valid while this stage lives.
+    Span<const uint8_t> prepare(VulkanDevice* vulkanDevice, ByteSpan ir, Span<GpuSpecConstant> specConstants, const VkSpecializationInfo** specInfo)
+    {
+        module = staticSamplerModule(vulkanDevice, ir);
+
+        const VkSpecializationMapEntry* mapEntries = module->entries.data();
+        const uint64_t* mapData = module->slots.data();
+        size_t entryCount = module->entries.size();
+        size_t dataCount = module->slots.size();
+        if (!specConstants.empty())
+        {
+            entries = module->entries;
+            data = module->slots;
+            for (const GpuSpecConstant& constant : specConstants)
+            {
+                // SpecIds taken by STATIC_SAMPLER declarations stay with the
+                // sampler; overriding one would bind the wrong heap slot.
+                bool taken = std::any_of(module->entries.begin(), module->entries.end(),
+                                         [&](const VkSpecializationMapEntry& entry) { return entry.constantID == constant.id; });
+                if (taken)
+                {
+                    fprintf(stderr, "NoGraphicsAPI: GpuSpecConstant id %u is a STATIC_SAMPLER's SpecId in this shader; pick an id the shader declares for it\n", constant.id);
+                    assert(false && "GpuSpecConstant id collides with a static sampler");
+                    continue;
+                }
+                entries.push_back({ constant.id, static_cast<uint32_t>(data.size() * sizeof(uint64_t)), constant.size });
+                data.push_back(constant.value);
+            }
+            mapEntries = entries.data();
+            mapData = data.data();
+            entryCount = entries.size();
+            dataCount = data.size();
+        }
+
+        *specInfo = nullptr;
+        if (entryCount > 0)
+        {
+            info.mapEntryCount = static_cast<uint32_t>(entryCount);
+            info.pMapEntries = mapEntries;
+            info.dataSize = dataCount * sizeof(uint64_t);
+            info.pData = mapData;
+            *specInfo = &info;
+        }
+
+        if (module->patchedIR.empty())
+        {
+            return ir;
+        }
+        return Span<const uint8_t>(module->patchedIR.data(), module->patchedIR.size());
     }
 };
 
-GpuPipeline gpuCreateComputePipeline(GpuDevice device, ByteSpan computeIR, const char* entry)
+// Everything a VkComputePipelineCreateInfo points at. The SPIR-V is chained
+// straight into the stage (maintenance5), so no VkShaderModule is created.
+// Not movable once prepared: batches keep one per pipeline in place.
+struct ComputePipelineBuild
 {
-    VulkanDevice* vulkanDevice = device->vulkanDevice;
-    VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
     StaticSamplerStage samplerStage;
-    const VkSpecializationInfo* samplerSpecInfo = nullptr;
-    ByteSpan moduleIR = samplerStage.prepare(vulkanDevice, computeIR, &samplerSpecInfo);
-
-    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shaderModuleCreateInfo.codeSize = moduleIR.size();
-    shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(moduleIR.data());
-    VkShaderModule shaderModule;
-    vulkanDevice->dispatchTable.createShaderModule(&shaderModuleCreateInfo, nullptr, &shaderModule);
-
-    VkComputePipelineCreateInfo pipelineCreateInfo = {};
-    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.layout = vulkanDevice->layout[VK_PIPELINE_BIND_POINT_COMPUTE];
-    pipelineCreateInfo.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
-    pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    pipelineCreateInfo.stage.module = shaderModule;
-    pipelineCreateInfo.stage.pSpecializationInfo = samplerSpecInfo;
-    pipelineCreateInfo.stage.pName = entry;
+    VkShaderModuleCreateInfo moduleInfo = {};
+    VkComputePipelineCreateInfo createInfo = {};
 
-    VkPipeline pipeline;
-    vulkanDevice->dispatchTable.createComputePipelines(VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
-    vulkanDevice->dispatchTable.destroyShaderModule(shaderModule, nullptr);
+    void prepare(VulkanDevice* vulkanDevice, const GpuComputePipelineDesc& desc)
+    {
+        const VkSpecializationInfo* samplerSpecInfo = nullptr;
+        Span<const uint8_t> moduleIR = samplerStage.prepare(vulkanDevice, desc.computeIR, desc.specConstants, &samplerSpecInfo);
+
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = moduleIR.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t*>(moduleIR.data());
+
+        createInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        createInfo.layout = vulkanDevice->layout[VK_PIPELINE_BIND_POINT_COMPUTE];
+        createInfo.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+        createInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        createInfo.stage.pNext = &moduleInfo;
+        createInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        createInfo.stage.module = VK_NULL_HANDLE;
+        createInfo.stage.pSpecializationInfo = samplerSpecInfo;
+        createInfo.stage.pName = desc.entry;
+    }
+
+    static void create(VulkanDevice* vulkanDevice, uint32_t count, const VkComputePipelineCreateInfo* infos, VkPipeline* pipelines)
+    {
+        vulkanDevice->dispatchTable.createComputePipelines(VK_NULL_HANDLE, count, infos, nullptr, pipelines);
+    }
+};
+
+// Pipelines per vkCreate*Pipelines call in a batch: large enough to amortize
+// the call, small enough that a few thousand pipelines spread over all cores.
+constexpr uint32_t PIPELINE_BATCH_CHUNK = 16;
+
+// Prepares and creates descs.size() pipelines, PIPELINE_BATCH_CHUNK per
+// vkCreate*Pipelines call, with chunks spread over up to one thread per core.
+// The calling thread takes chunks too; small batches never spawn threads.
+template <typename Build, typename Desc>
+static void createPipelinesParallel(VulkanDevice* vulkanDevice, Span<Desc> descs, VkPipeline* pipelines)
+{
+    const uint32_t count = static_cast<uint32_t>(descs.size());
+    const uint32_t chunkCount = (count + PIPELINE_BATCH_CHUNK - 1) / PIPELINE_BATCH_CHUNK;
+    std::atomic<uint32_t> nextChunk = 0;
+
+    auto worker = [&]()
+    {
+        using CreateInfo = decltype(Build::createInfo);
+        for (uint32_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+        {
+            const uint32_t first = chunk * PIPELINE_BATCH_CHUNK;
+            const uint32_t size = std::min(PIPELINE_BATCH_CHUNK, count - first);
+            std::vector<Build> builds(size);
+            std::vector<CreateInfo> infos(size);
+            for (uint32_t i = 0; i < size; i++)
+            {
+                builds[i].prepare(vulkanDevice, descs[first + i]);
+                infos[i] = builds[i].createInfo;
+            }
+            Build::create(vulkanDevice, size, infos.data(), pipelines + first);
+        }
+    };
+
+    const uint32_t threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), chunkCount);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; i++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
 
-    return new GpuPipeline_T{ pipeline, VK_PIPELINE_BIND_POINT_COMPUTE, device };
+GpuPipeline gpuCreateComputePipeline(GpuDevice device, ByteSpan computeIR, const char* entry, Span<GpuSpecConstant> specConstants)
+{
+    GpuComputePipelineDesc desc = { computeIR, entry, specConstants };
+    GpuPipeline pipeline = nullptr;
+    gpuCreateComputePipelines(device, Span<GpuComputePipelineDesc>(&desc, 1), Span<GpuPipeline>(&pipeline, 1));
+    return pipeline;
+}
+
+void gpuCreateComputePipelines(GpuDevice device, Span<GpuComputePipelineDesc> descs, Span<GpuPipeline> pipelines)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    std::vector<VkPipeline> vkPipelines(descs.size(), VK_NULL_HANDLE);
+    createPipelinesParallel<ComputePipelineBuild>(vulkanDevice, descs, vkPipelines.data());
+    for (size_t i = 0; i < descs.size(); i++)
+    {
+        pipelines[i] = new GpuPipeline_T{ vkPipelines[i], VK_PIPELINE_BIND_POINT_COMPUTE, device };
+    }
 }
 
 // Everything here used to be created lazily on first use — including inside
@@ -1706,204 +2719,358 @@ void initDeviceResources(GpuDevice device)
     }
 }
 
-VkPipeline gpuCreateGraphicsPipelineInternal(VulkanDevice* vulkanDevice, ByteSpan vertexIR, ByteSpan meshletIR, ByteSpan pixelIR, GpuRasterDesc desc)
+// Everything a VkGraphicsPipelineCreateInfo points at, for one pipeline; the
+// graphics counterpart of ComputePipelineBuild.
+struct GraphicsPipelineBuild
 {
-    bool vertex = vertexIR.size() > 0;
-    ByteSpan actualIR = vertex ? vertexIR : meshletIR;
-
     StaticSamplerStage vertexSamplerStage;
-    const VkSpecializationInfo* vertexSamplerSpecInfo = nullptr;
-    ByteSpan vertexModuleIR = vertexSamplerStage.prepare(vulkanDevice, actualIR, &vertexSamplerSpecInfo);
-
     StaticSamplerStage pixelSamplerStage;
-    const VkSpecializationInfo* pixelSamplerSpecInfo = nullptr;
-    ByteSpan pixelModuleIR = pixelSamplerStage.prepare(vulkanDevice, pixelIR, &pixelSamplerSpecInfo);
-
-    VkShaderModuleCreateInfo vertexShaderModuleCreateInfo = {};
-    vertexShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    vertexShaderModuleCreateInfo.codeSize = vertexModuleIR.size();
-    vertexShaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(vertexModuleIR.data());
-    VkShaderModule vertexShaderModule;
-    vulkanDevice->dispatchTable.createShaderModule(&vertexShaderModuleCreateInfo, nullptr, &vertexShaderModule);
-
-    VkShaderModuleCreateInfo pixelShaderModuleCreateInfo = {};
-    pixelShaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    pixelShaderModuleCreateInfo.codeSize = pixelModuleIR.size();
-    pixelShaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(pixelModuleIR.data());
-    VkShaderModule pixelShaderModule;
-    vulkanDevice->dispatchTable.createShaderModule(&pixelShaderModuleCreateInfo, nullptr, &pixelShaderModule);
-
+    VkShaderModuleCreateInfo vertexModuleInfo = {};
+    VkShaderModuleCreateInfo pixelModuleInfo = {};
     VkPipelineShaderStageCreateInfo shaderStages[2] = {};
-    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStages[0].stage = vertex ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_MESH_BIT_NV;
-    shaderStages[0].module = vertexShaderModule;
-    shaderStages[0].pName = "main";
-    shaderStages[0].pSpecializationInfo = vertexSamplerSpecInfo;
-
-    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    shaderStages[1].module = pixelShaderModule;
-    shaderStages[1].pName = "main";
-    shaderStages[1].pSpecializationInfo = pixelSamplerSpecInfo;
-
     std::vector<VkFormat> colorFormats;
     std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+    VkPipelineRenderingCreateInfo pipelineRenderingInfo = {};
+    VkPipelineColorBlendStateCreateInfo blendState = {};
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    VkPipelineMultisampleStateCreateInfo multisampleState = {};
+    VkPipelineRasterizationStateCreateInfo rasterizationState = {};
+    VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
+    std::vector<VkDynamicState> dynamicStates;
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    VkGraphicsPipelineCreateInfo createInfo = {};
 
-    for (auto& target : desc.colorTargets)
+    void prepare(VulkanDevice* vulkanDevice, const GpuGraphicsPipelineDesc& pipelineDesc)
     {
-        colorFormats.push_back(gpuFormatToVkFormat(target.format));
+        const GpuRasterDesc& desc = pipelineDesc.raster;
+        bool vertex = pipelineDesc.vertexIR.size() > 0;
+        ByteSpan actualIR = vertex ? pipelineDesc.vertexIR : pipelineDesc.meshletIR;
+
+        const VkSpecializationInfo* vertexSamplerSpecInfo = nullptr;
+        Span<const uint8_t> vertexModuleIR = vertexSamplerStage.prepare(vulkanDevice, actualIR, pipelineDesc.specConstants, &vertexSamplerSpecInfo);
+
+        const VkSpecializationInfo* pixelSamplerSpecInfo = nullptr;
+        Span<const uint8_t> pixelModuleIR = pixelSamplerStage.prepare(vulkanDevice, pipelineDesc.pixelIR, pipelineDesc.specConstants, &pixelSamplerSpecInfo);
+
+        vertexModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        vertexModuleInfo.codeSize = vertexModuleIR.size();
+        vertexModuleInfo.pCode = reinterpret_cast<const uint32_t*>(vertexModuleIR.data());
+
+        pixelModuleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        pixelModuleInfo.codeSize = pixelModuleIR.size();
+        pixelModuleInfo.pCode = reinterpret_cast<const uint32_t*>(pixelModuleIR.data());
+
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].pNext = &vertexModuleInfo;
+        shaderStages[0].stage = vertex ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_MESH_BIT_NV;
+        shaderStages[0].module = VK_NULL_HANDLE;
+        shaderStages[0].pName = pipelineDesc.vertexEntry;
+        shaderStages[0].pSpecializationInfo = vertexSamplerSpecInfo;
+
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].pNext = &pixelModuleInfo;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = VK_NULL_HANDLE;
+        shaderStages[1].pName = pipelineDesc.pixelEntry;
+        shaderStages[1].pSpecializationInfo = pixelSamplerSpecInfo;
+
+        for (auto& target : desc.colorTargets)
+        {
+            colorFormats.push_back(gpuFormatToVkFormat(target.format));
+
+            VkPipelineColorBlendAttachmentState blendAttachment = {};
+
+            if (desc.blendState)
+            {
+                GpuBlendDesc blendDesc = *desc.blendState;
+                blendAttachment.blendEnable = VK_TRUE;
+                blendAttachment.srcColorBlendFactor = gpuFactorToVkFactor(blendDesc.srcColorFactor);
+                blendAttachment.dstColorBlendFactor = gpuFactorToVkFactor(blendDesc.dstColorFactor);
+                blendAttachment.colorBlendOp = gpuBlendOpToVkBlendOp(blendDesc.colorOp);
+                blendAttachment.srcAlphaBlendFactor = gpuFactorToVkFactor(blendDesc.srcAlphaFactor);
+                blendAttachment.dstAlphaBlendFactor = gpuFactorToVkFactor(blendDesc.dstAlphaFactor);
+                blendAttachment.alphaBlendOp = gpuBlendOpToVkBlendOp(blendDesc.alphaOp);
+                blendAttachment.colorWriteMask =
+                    ((blendDesc.colorWriteMask & 0x1) ? VK_COLOR_COMPONENT_R_BIT : 0) |
+                    ((blendDesc.colorWriteMask & 0x2) ? VK_COLOR_COMPONENT_G_BIT : 0) |
+                    ((blendDesc.colorWriteMask & 0x4) ? VK_COLOR_COMPONENT_B_BIT : 0) |
+                    ((blendDesc.colorWriteMask & 0x8) ? VK_COLOR_COMPONENT_A_BIT : 0);
+            }
+            else
+            {
+                blendAttachment.blendEnable = VK_FALSE;
+                blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+                blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+                blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+                blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+                blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+                blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+                blendAttachment.colorWriteMask =
+                    ((target.writeMask & 0x1) ? VK_COLOR_COMPONENT_R_BIT : 0) |
+                    ((target.writeMask & 0x2) ? VK_COLOR_COMPONENT_G_BIT : 0) |
+                    ((target.writeMask & 0x4) ? VK_COLOR_COMPONENT_B_BIT : 0) |
+                    ((target.writeMask & 0x8) ? VK_COLOR_COMPONENT_A_BIT : 0);
+            }
 
-        VkPipelineColorBlendAttachmentState blendAttachment = {};
+            blendAttachments.push_back(blendAttachment);
+        }
 
-        if (desc.blendState)
+        pipelineRenderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        pipelineRenderingInfo.viewMask = desc.viewMask;
+        pipelineRenderingInfo.colorAttachmentCount = desc.colorTargets.size();
+        pipelineRenderingInfo.pColorAttachmentFormats = colorFormats.data();
+        // A combined depth/stencil depthFormat also declares the stencil
+        // attachment, matching what gpuBeginRenderPass attaches for it.
+        const FORMAT stencilFormat = desc.stencilFormat != FORMAT_NONE ? desc.stencilFormat :
+                                     gpuFormatHasStencil(desc.depthFormat) ? desc.depthFormat : FORMAT_NONE;
+        pipelineRenderingInfo.depthAttachmentFormat = gpuFormatHasDepth(desc.depthFormat) ? gpuFormatToVkFormat(desc.depthFormat) : VK_FORMAT_UNDEFINED;
+        pipelineRenderingInfo.stencilAttachmentFormat = gpuFormatToVkFormat(stencilFormat);
+
+        blendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        blendState.attachmentCount = blendAttachments.size();
+        blendState.pAttachments = blendAttachments.data();
+
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssemblyInfo.topology = gpuTopologyToVkTopology(desc.topology);
+        inputAssemblyInfo.primitiveRestartEnable = desc.primitiveRestart ? VK_TRUE : VK_FALSE;
+
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+        viewportState.pViewports = nullptr;
+        viewportState.pScissors = nullptr;
+
+        multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampleState.rasterizationSamples = static_cast<VkSampleCountFlagBits>(desc.sampleCount);
+        multisampleState.alphaToCoverageEnable = desc.alphaToCoverage ? VK_TRUE : VK_FALSE;
+
+        rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizationState.polygonMode = gpuFillModeToVkPolygonMode(desc.fillMode);
+        rasterizationState.cullMode = gpuCullToVkCullMode(desc.cull);
+        rasterizationState.frontFace = gpuCullToVkFrontFace(desc.cull);
+        rasterizationState.lineWidth = 1.0f;
+        rasterizationState.depthClampEnable = VK_FALSE;
+        rasterizationState.rasterizerDiscardEnable = VK_FALSE;
+        rasterizationState.depthBiasEnable = VK_FALSE;
+
+        depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencilState.depthTestEnable = (desc.depthFormat != FORMAT_NONE) ? VK_TRUE : VK_FALSE;
+        depthStencilState.depthWriteEnable = (desc.depthFormat != FORMAT_NONE) ? VK_TRUE : VK_FALSE;
+        depthStencilState.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencilState.depthBoundsTestEnable = VK_FALSE;
+        depthStencilState.stencilTestEnable = (desc.stencilFormat != FORMAT_NONE) ? VK_TRUE : VK_FALSE;
+        depthStencilState.minDepthBounds = 0.0f;
+        depthStencilState.maxDepthBounds = 1.0f;
+
+        dynamicStates.assign({
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR,
+            VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+            VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+            VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+            VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE,
+            VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE,
+            VK_DYNAMIC_STATE_STENCIL_OP,
+            VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK,
+            VK_DYNAMIC_STATE_STENCIL_WRITE_MASK,
+            VK_DYNAMIC_STATE_STENCIL_REFERENCE,
+            VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE,
+            VK_DYNAMIC_STATE_DEPTH_BIAS,
+            VK_DYNAMIC_STATE_CULL_MODE,
+            VK_DYNAMIC_STATE_FRONT_FACE,
+            VK_DYNAMIC_STATE_LINE_WIDTH
+        });
+        // Mesh pipelines have no input assembly to make dynamic.
+        if (vertex)
         {
-            GpuBlendDesc blendDesc = *desc.blendState;
-            blendAttachment.blendEnable = VK_TRUE;
-            blendAttachment.srcColorBlendFactor = gpuFactorToVkFactor(blendDesc.srcColorFactor);
-            blendAttachment.dstColorBlendFactor = gpuFactorToVkFactor(blendDesc.dstColorFactor);
-            blendAttachment.colorBlendOp = gpuBlendOpToVkBlendOp(blendDesc.colorOp);
-            blendAttachment.srcAlphaBlendFactor = gpuFactorToVkFactor(blendDesc.srcAlphaFactor);
-            blendAttachment.dstAlphaBlendFactor = gpuFactorToVkFactor(blendDesc.dstAlphaFactor);
-            blendAttachment.alphaBlendOp = gpuBlendOpToVkBlendOp(blendDesc.alphaOp);
-            blendAttachment.colorWriteMask =
-                ((blendDesc.colorWriteMask & 0x1) ? VK_COLOR_COMPONENT_R_BIT : 0) |
-                ((blendDesc.colorWriteMask & 0x2) ? VK_COLOR_COMPONENT_G_BIT : 0) |
-                ((blendDesc.colorWriteMask & 0x4) ? VK_COLOR_COMPONENT_B_BIT : 0) |
-                ((blendDesc.colorWriteMask & 0x8) ? VK_COLOR_COMPONENT_A_BIT : 0);
+            dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY);
+            dynamicStates.push_back(VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE);
         }
-        else
+        if (vulkanDevice->dynamicPolygonMode)
         {
-            blendAttachment.blendEnable = VK_FALSE;
-            blendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-            blendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-            blendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-            blendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-            blendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-            blendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-            blendAttachment.colorWriteMask =
-                ((target.writeMask & 0x1) ? VK_COLOR_COMPONENT_R_BIT : 0) |
-                ((target.writeMask & 0x2) ? VK_COLOR_COMPONENT_G_BIT : 0) |
-                ((target.writeMask & 0x4) ? VK_COLOR_COMPONENT_B_BIT : 0) |
-                ((target.writeMask & 0x8) ? VK_COLOR_COMPONENT_A_BIT : 0);
+            dynamicStates.push_back(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
         }
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicState.pDynamicStates = dynamicStates.data();
+
+        createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        createInfo.pNext = &pipelineRenderingInfo;
+        createInfo.layout = vulkanDevice->layout[VK_PIPELINE_BIND_POINT_GRAPHICS];
+        createInfo.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+        createInfo.pStages = shaderStages;
+        createInfo.pVertexInputState = &vertexInputInfo;
+        createInfo.pInputAssemblyState = &inputAssemblyInfo;
+        createInfo.pColorBlendState = &blendState;
+        createInfo.pViewportState = &viewportState;
+        createInfo.pRasterizationState = &rasterizationState;
+        createInfo.pDepthStencilState = &depthStencilState;
+        createInfo.pMultisampleState = &multisampleState;
+        createInfo.pDynamicState = &dynamicState;
+        createInfo.stageCount = 2;
+    }
 
-        blendAttachments.push_back(blendAttachment);
+    static void create(VulkanDevice* vulkanDevice, uint32_t count, const VkGraphicsPipelineCreateInfo* infos, VkPipeline* pipelines)
+    {
+        vulkanDevice->dispatchTable.createGraphicsPipelines(VK_NULL_HANDLE, count, infos, nullptr, pipelines);
     }
+};
 
-    VkPipelineRenderingCreateInfo pipelineRenderingInfo = {};
-    pipelineRenderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
-    pipelineRenderingInfo.colorAttachmentCount = desc.colorTargets.size();
-    pipelineRenderingInfo.pColorAttachmentFormats = colorFormats.data();
-    pipelineRenderingInfo.depthAttachmentFormat = gpuFormatToVkFormat(desc.depthFormat);
-    pipelineRenderingInfo.stencilAttachmentFormat = gpuFormatToVkFormat(desc.stencilFormat);
+// Records the raster values gpuSetPipeline re-applies as dynamic state.
+static GpuPipeline graphicsPipelineHandle(GpuDevice device, VkPipeline vkPipeline, const GpuGraphicsPipelineDesc& desc, bool ready = true)
+{
+    GpuPipeline pipeline = new GpuPipeline_T{ vkPipeline, VK_PIPELINE_BIND_POINT_GRAPHICS, device, ready };
+    pipeline->meshlet = desc.vertexIR.empty();
+    pipeline->cull = desc.raster.cull;
+    pipeline->topology = desc.raster.topology;
+    pipeline->primitiveRestart = desc.raster.primitiveRestart;
+    pipeline->fillMode = desc.raster.fillMode;
+    return pipeline;
+}
 
-    VkPipelineColorBlendStateCreateInfo blendState = {};
-    blendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    blendState.attachmentCount = blendAttachments.size();
-    blendState.pAttachments = blendAttachments.data();
+VkPipeline gpuCreateGraphicsPipelineInternal(VulkanDevice* vulkanDevice, const GpuGraphicsPipelineDesc& desc)
+{
+    GraphicsPipelineBuild build;
+    build.prepare(vulkanDevice, desc);
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    GraphicsPipelineBuild::create(vulkanDevice, 1, &build.createInfo, &pipeline);
+    return pipeline;
+}
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo = {};
-    inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyInfo.topology = desc.topology == TOPOLOGY_TRIANGLE_LIST ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST : desc.topology == TOPOLOGY_TRIANGLE_STRIP ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP
-                                                                                                             : desc.topology == TOPOLOGY_TRIANGLE_FAN     ? VK_PRIMITIVE_TOPOLOGY_TRIANGLE_FAN
-                                                                                                                                                          : VK_PRIMITIVE_TOPOLOGY_MAX_ENUM;
+GpuPipeline gpuCreateGraphicsPipeline(GpuDevice device, ByteSpan vertexIR, ByteSpan pixelIR, GpuRasterDesc desc,
+                                      const char* vertexEntry, const char* pixelEntry, Span<GpuSpecConstant> specConstants)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    GpuGraphicsPipelineDesc pipelineDesc = {
+        .vertexIR = vertexIR,
+        .pixelIR = pixelIR,
+        .raster = desc,
+        .vertexEntry = vertexEntry,
+        .pixelEntry = pixelEntry,
+        .specConstants = specConstants
+    };
+    VkPipeline pipeline = gpuCreateGraphicsPipelineInternal(vulkanDevice, pipelineDesc);
+    return graphicsPipelineHandle(device, pipeline, pipelineDesc);
+}
 
-    VkPipelineViewportStateCreateInfo viewportState = {};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount = 1;
-    viewportState.pViewports = nullptr;
-    viewportState.pScissors = nullptr;
+GpuPipeline gpuCreateGraphicsMeshletPipeline(GpuDevice device, ByteSpan meshletIR, ByteSpan pixelIR, GpuRasterDesc desc,
+                                             const char* meshletEntry, const char* pixelEntry, Span<GpuSpecConstant> specConstants)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    GpuGraphicsPipelineDesc pipelineDesc = {
+        .meshletIR = meshletIR,
+        .pixelIR = pixelIR,
+        .raster = desc,
+        .vertexEntry = meshletEntry,
+        .pixelEntry = pixelEntry,
+        .specConstants = specConstants
+    };
+    VkPipeline pipeline = gpuCreateGraphicsPipelineInternal(vulkanDevice, pipelineDesc);
+    return graphicsPipelineHandle(device, pipeline, pipelineDesc);
+}
 
-    VkPipelineMultisampleStateCreateInfo multisampleState = {};
-    multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampleState.rasterizationSamples = static_cast<VkSampleCountFlagBits>(desc.sampleCount);
-    multisampleState.alphaToCoverageEnable = desc.alphaToCoverage ? VK_TRUE : VK_FALSE;
+void gpuCreateGraphicsPipelines(GpuDevice device, Span<GpuGraphicsPipelineDesc> descs, Span<GpuPipeline> pipelines)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    std::vector<VkPipeline> vkPipelines(descs.size(), VK_NULL_HANDLE);
+    createPipelinesParallel<GraphicsPipelineBuild>(vulkanDevice, descs, vkPipelines.data());
+    for (size_t i = 0; i < descs.size(); i++)
+    {
+        pipelines[i] = graphicsPipelineHandle(device, vkPipelines[i], descs[i]);
+    }
+}
 
-    VkPipelineRasterizationStateCreateInfo rasterizationState = {};
-    rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizationState.cullMode = desc.cull != CULL_NONE ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE;
-    rasterizationState.frontFace = desc.cull == CULL_CW ? VK_FRONT_FACE_CLOCKWISE : VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizationState.lineWidth = 1.0f;
-    rasterizationState.depthClampEnable = VK_FALSE;
-    rasterizationState.rasterizerDiscardEnable = VK_FALSE;
-    rasterizationState.depthBiasEnable = VK_FALSE;
+// Async creation copies everything the desc points at (IR, entry names, spec
+// constants, color targets, blend state) so the caller's buffers can go away
+// as soon as this returns.
+GpuPipeline gpuCreateComputePipelineAsync(GpuDevice device, GpuComputePipelineDesc desc, GpuPipeline fallback)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    GpuPipeline pipeline = new GpuPipeline_T{ VK_NULL_HANDLE, VK_PIPELINE_BIND_POINT_COMPUTE, device, false, fallback };
 
-    VkPipelineDepthStencilStateCreateInfo depthStencilState = {};
-    depthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencilState.depthTestEnable = (desc.depthFormat != FORMAT_NONE) ? VK_TRUE : VK_FALSE;
-    depthStencilState.depthWriteEnable = (desc.depthFormat != FORMAT_NONE) ? VK_TRUE : VK_FALSE;
-    depthStencilState.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencilState.depthBoundsTestEnable = VK_FALSE;
-    depthStencilState.stencilTestEnable = (desc.stencilFormat != FORMAT_NONE) ? VK_TRUE : VK_FALSE;
-    depthStencilState.minDepthBounds = 0.0f;
-    depthStencilState.maxDepthBounds = 1.0f;
+    vulkanDevice->enqueuePipelineJob(
+        [vulkanDevice, pipeline,
+         ir = std::vector<uint8_t>(desc.computeIR.begin(), desc.computeIR.end()),
+         entry = std::string(desc.entry),
+         specConstants = std::vector<GpuSpecConstant>(desc.specConstants.begin(), desc.specConstants.end())]() mutable
+        {
+            ComputePipelineBuild build;
+            build.prepare(vulkanDevice, GpuComputePipelineDesc{ ByteSpan(ir), entry.c_str(), Span<GpuSpecConstant>(specConstants) });
+            ComputePipelineBuild::create(vulkanDevice, 1, &build.createInfo, &pipeline->pipeline);
+            pipeline->ready.store(true, std::memory_order_release);
+            pipeline->ready.notify_all();
+        });
+    return pipeline;
+}
 
-    VkPipelineDynamicStateCreateInfo dynamicState = {};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR,
-        VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
-        VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
-        VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
-        VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE,
-        VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE,
-        VK_DYNAMIC_STATE_STENCIL_OP,
-        VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK,
-        VK_DYNAMIC_STATE_STENCIL_WRITE_MASK,
-        VK_DYNAMIC_STATE_STENCIL_REFERENCE,
-        VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE,
-        VK_DYNAMIC_STATE_DEPTH_BIAS
-    };
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates = dynamicStates.data();
-
-    VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
-    pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCreateInfo.pNext = &pipelineRenderingInfo;
-    pipelineCreateInfo.layout = vulkanDevice->layout[VK_PIPELINE_BIND_POINT_GRAPHICS];
-    pipelineCreateInfo.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
-    pipelineCreateInfo.pStages = shaderStages;
-    pipelineCreateInfo.pVertexInputState = &vertexInputInfo;
-    pipelineCreateInfo.pInputAssemblyState = &inputAssemblyInfo;
-    pipelineCreateInfo.pColorBlendState = &blendState;
-    pipelineCreateInfo.pViewportState = &viewportState;
-    pipelineCreateInfo.pRasterizationState = &rasterizationState;
-    pipelineCreateInfo.pDepthStencilState = &depthStencilState;
-    pipelineCreateInfo.pMultisampleState = &multisampleState;
-    pipelineCreateInfo.pDynamicState = &dynamicState;
-    pipelineCreateInfo.stageCount = 2;
+GpuPipeline gpuCreateGraphicsPipelineAsync(GpuDevice device, GpuGraphicsPipelineDesc desc, GpuPipeline fallback)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    GpuPipeline pipeline = graphicsPipelineHandle(device, VK_NULL_HANDLE, desc, false);
+    pipeline->fallback = fallback;
 
-    VkPipeline pipeline;
-    vulkanDevice->dispatchTable.createGraphicsPipelines(VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline);
-    vulkanDevice->dispatchTable.destroyShaderModule(vertexShaderModule, nullptr);
-    vulkanDevice->dispatchTable.destroyShaderModule(pixelShaderModule, nullptr);
+    struct OwnedDesc
+    {
+        std::vector<uint8_t> vertexIR, meshletIR, pixelIR;
+        std::vector<ColorTarget> colorTargets;
+        GpuBlendDesc blendState = {};
+        std::string vertexEntry, pixelEntry;
+        std::vector<GpuSpecConstant> specConstants;
+        GpuGraphicsPipelineDesc desc = {};
+    };
+    auto owned = std::make_shared<OwnedDesc>();
+    owned->vertexIR.assign(desc.vertexIR.begin(), desc.vertexIR.end());
+    owned->meshletIR.assign(desc.meshletIR.begin(), desc.meshletIR.end());
+    owned->pixelIR.assign(desc.pixelIR.begin(), desc.pixelIR.end());
+    owned->colorTargets.assign(desc.raster.colorTargets.begin(), desc.raster.colorTargets.end());
+    owned->vertexEntry = desc.vertexEntry;
+    owned->pixelEntry = desc.pixelEntry;
+    owned->specConstants.assign(desc.specConstants.begin(), desc.specConstants.end());
+    owned->desc = {
+        .vertexIR = ByteSpan(owned->vertexIR),
+        .meshletIR = ByteSpan(owned->meshletIR),
+        .pixelIR = ByteSpan(owned->pixelIR),
+        .raster = desc.raster,
+        .vertexEntry = owned->vertexEntry.c_str(),
+        .pixelEntry = owned->pixelEntry.c_str(),
+        .specConstants = Span<GpuSpecConstant>(owned->specConstants)
+    };
+    owned->desc.raster.colorTargets = Span<ColorTarget>(owned->colorTargets);
+    if (desc.raster.blendState)
+    {
+        owned->blendState = *desc.raster.blendState;
+        owned->desc.raster.blendState = &owned->blendState;
+    }
 
+    vulkanDevice->enqueuePipelineJob(
+        [vulkanDevice, pipeline, owned]()
+        {
+            pipeline->pipeline = gpuCreateGraphicsPipelineInternal(vulkanDevice, owned->desc);
+            pipeline->ready.store(true, std::memory_order_release);
+            pipeline->ready.notify_all();
+        });
     return pipeline;
 }
 
-GpuPipeline gpuCreateGraphicsPipeline(GpuDevice device, ByteSpan vertexIR, ByteSpan pixelIR, GpuRasterDesc desc)
+bool gpuPipelineReady(GpuPipeline pipeline)
 {
-    VulkanDevice* vulkanDevice = device->vulkanDevice;
-    VkPipeline pipeline = gpuCreateGraphicsPipelineInternal(vulkanDevice, vertexIR, ByteSpan{}, pixelIR, desc);
-    return new GpuPipeline_T{ pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS, device };
+    return pipeline->ready.load(std::memory_order_acquire);
 }
 
-GpuPipeline gpuCreateGraphicsMeshletPipeline(GpuDevice device, ByteSpan meshletIR, ByteSpan pixelIR, GpuRasterDesc desc)
+void gpuWaitPipeline(GpuPipeline pipeline)
 {
-    VulkanDevice* vulkanDevice = device->vulkanDevice;
-    VkPipeline pipeline = gpuCreateGraphicsPipelineInternal(vulkanDevice, ByteSpan{}, meshletIR, pixelIR, desc);
-    return new GpuPipeline_T{ pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS, device };
+    pipeline->ready.wait(false, std::memory_order_acquire);
 }
 
 void gpuFreePipeline(GpuPipeline pipeline)
 {
     VulkanDevice* vulkanDevice = pipeline->device->vulkanDevice;
+    gpuWaitPipeline(pipeline);
     vulkanDevice->dispatchTable.destroyPipeline(pipeline->pipeline, nullptr);
     delete pipeline;
 }
@@ -2113,62 +3280,164 @@ void gpuMemCpy(GpuCommandBuffer cb, void* destGpu, void* srcGpu, uint64_t size)
     vulkanDevice->dispatchTable.cmdCopyBuffer(cb->commandBuffer, src.buffer, dst.buffer, 1, &copyRegion);
 }
 
-void gpuCopyToTexture(GpuCommandBuffer cb, void* srcGpu, GpuTexture texture)
+// Resolves a region's defaults (ALL_LAYERS, zero extent axes) against the
+// texture's mip size.
+static VkImageSubresourceLayers textureRegionSubresource(GpuTexture texture, const GpuTextureRegion& region)
 {
-    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
-    Allocation src = vulkanDevice->findAllocation(reinterpret_cast<VkDeviceAddress>(srcGpu));
+    const uint32_t textureLayers = gpuTextureLayerCount(texture->desc);
+    VkImageSubresourceLayers subresource = {};
+    subresource.aspectMask = region.stencil ? VK_IMAGE_ASPECT_STENCIL_BIT : gpuFormatPrimaryAspect(texture->desc.format);
+    subresource.mipLevel = region.mip;
+    subresource.baseArrayLayer = region.baseLayer;
+    subresource.layerCount = region.layerCount == ALL_LAYERS ? textureLayers - region.baseLayer : region.layerCount;
+    return subresource;
+}
+
+static VkExtent3D textureRegionExtent(GpuTexture texture, const GpuTextureRegion& region)
+{
+    VkExtent3D mipExtent = gpuTextureExtent(texture->desc);
+    mipExtent.width = std::max(mipExtent.width >> region.mip, 1u);
+    mipExtent.height = std::max(mipExtent.height >> region.mip, 1u);
+    mipExtent.depth = std::max(mipExtent.depth >> region.mip, 1u);
+    return {
+        region.extent.x ? region.extent.x : mipExtent.width - region.offset.x,
+        region.extent.y ? region.extent.y : mipExtent.height - region.offset.y,
+        region.extent.z ? region.extent.z : mipExtent.depth - region.offset.z
+    };
+}
 
+// Vulkan describes buffer pitches in texels, we take them in bytes.
+static VkBufferImageCopy bufferTextureCopyRegion(GpuTexture texture, const GpuBufferTextureCopy& copy, VkDeviceAddress bufferAddress)
+{
+    assert(!copy.region.stencil || gpuFormatHasStencil(texture->desc.format));
+    const GpuFormatBlock block = copy.region.stencil ? GpuFormatBlock{ 1, 1, 1 } : gpuFormatBlock(texture->desc.format);
     VkBufferImageCopy region = {};
-    region.bufferOffset = reinterpret_cast<VkDeviceAddress>(srcGpu) - src.address;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { texture->desc.dimensions.x, texture->desc.dimensions.y, texture->desc.dimensions.z };
+    region.bufferOffset = reinterpret_cast<VkDeviceAddress>(copy.bufferGpu) - bufferAddress;
+    if (copy.rowPitch)
+    {
+        assert(copy.rowPitch % block.bytes == 0);
+        region.bufferRowLength = copy.rowPitch / block.bytes * block.width;
+    }
+    if (copy.slicePitch)
+    {
+        const VkExtent3D extent = textureRegionExtent(texture, copy.region);
+        const uint32_t rowPitch = copy.rowPitch ? copy.rowPitch : (extent.width + block.width - 1) / block.width * block.bytes;
+        assert(copy.slicePitch % rowPitch == 0);
+        region.bufferImageHeight = copy.slicePitch / rowPitch * block.height;
+    }
+    region.imageSubresource = textureRegionSubresource(texture, copy.region);
+    region.imageOffset = { static_cast<int32_t>(copy.region.offset.x), static_cast<int32_t>(copy.region.offset.y), static_cast<int32_t>(copy.region.offset.z) };
+    region.imageExtent = textureRegionExtent(texture, copy.region);
+    return region;
+}
+
+// Batches consecutive regions that live in the same gpuMalloc allocation into
+// one vkCmdCopyBufferToImage / vkCmdCopyImageToBuffer.
+template <typename Record>
+static void forEachBufferTextureBatch(VulkanDevice* vulkanDevice, GpuTexture texture, Span<GpuBufferTextureCopy> copies, Record record)
+{
+    std::vector<VkBufferImageCopy> regions;
+    regions.reserve(copies.size());
+    Allocation batch = {};
+    for (const GpuBufferTextureCopy& copy : copies)
+    {
+        Allocation alloc = vulkanDevice->findAllocation(reinterpret_cast<VkDeviceAddress>(copy.bufferGpu));
+        if (!regions.empty() && alloc.buffer != batch.buffer)
+        {
+            record(batch.buffer, regions);
+            regions.clear();
+        }
+        batch = alloc;
+        regions.push_back(bufferTextureCopyRegion(texture, copy, alloc.address));
+    }
+    if (!regions.empty())
+    {
+        record(batch.buffer, regions);
+    }
+}
 
+void gpuCopyToTexture(GpuCommandBuffer cb, GpuTexture texture, Span<GpuBufferTextureCopy> regions)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     transitionImageLayout(vulkanDevice, cb->commandBuffer, texture, VK_IMAGE_LAYOUT_GENERAL);
-    vulkanDevice->dispatchTable.cmdCopyBufferToImage(cb->commandBuffer, src.buffer, texture->image, VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+    forEachBufferTextureBatch(vulkanDevice, texture, regions, [&](VkBuffer buffer, const std::vector<VkBufferImageCopy>& batch)
+    {
+        vulkanDevice->dispatchTable.cmdCopyBufferToImage(cb->commandBuffer, buffer, texture->image, VK_IMAGE_LAYOUT_GENERAL, static_cast<uint32_t>(batch.size()), batch.data());
+    });
+}
+
+void gpuCopyFromTexture(GpuCommandBuffer cb, GpuTexture texture, Span<GpuBufferTextureCopy> regions)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    transitionImageLayout(vulkanDevice, cb->commandBuffer, texture, VK_IMAGE_LAYOUT_GENERAL);
+    forEachBufferTextureBatch(vulkanDevice, texture, regions, [&](VkBuffer buffer, const std::vector<VkBufferImageCopy>& batch)
+    {
+        vulkanDevice->dispatchTable.cmdCopyImageToBuffer(cb->commandBuffer, texture->image, VK_IMAGE_LAYOUT_GENERAL, buffer, static_cast<uint32_t>(batch.size()), batch.data());
+    });
+}
+
+// Whole mip 0, every layer, tightly packed.
+void gpuCopyToTexture(GpuCommandBuffer cb, void* srcGpu, GpuTexture texture)
+{
+    GpuBufferTextureCopy copy = { .bufferGpu = srcGpu };
+    gpuCopyToTexture(cb, texture, Span<GpuBufferTextureCopy>(&copy, 1));
 }
 
 void gpuCopyFromTexture(GpuCommandBuffer cb, void* destGpu, GpuTexture texture)
+{
+    GpuBufferTextureCopy copy = { .bufferGpu = destGpu };
+    gpuCopyFromTexture(cb, texture, Span<GpuBufferTextureCopy>(&copy, 1));
+}
+
+void gpuCopyTexture(GpuCommandBuffer cb, GpuTexture destTexture, GpuTexture srcTexture, Span<GpuTextureCopy> regions)
 {
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
-    Allocation dst = vulkanDevice->findAllocation(reinterpret_cast<VkDeviceAddress>(destGpu));
 
-    VkBufferImageCopy region = {};
-    region.bufferOffset = reinterpret_cast<VkDeviceAddress>(destGpu) - dst.address;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { texture->desc.dimensions.x, texture->desc.dimensions.y, texture->desc.dimensions.z };
+    std::vector<VkImageCopy2> copies;
+    copies.reserve(regions.size());
+    for (const GpuTextureCopy& region : regions)
+    {
+        VkImageCopy2 copy = {};
+        copy.sType = VK_STRUCTURE_TYPE_IMAGE_COPY_2;
+        copy.srcSubresource = textureRegionSubresource(srcTexture, region.src);
+        copy.srcOffset = { static_cast<int32_t>(region.src.offset.x), static_cast<int32_t>(region.src.offset.y), static_cast<int32_t>(region.src.offset.z) };
+        copy.dstSubresource = textureRegionSubresource(destTexture, region.dst);
+        copy.dstSubresource.layerCount = copy.srcSubresource.layerCount;
+        copy.dstOffset = { static_cast<int32_t>(region.dst.offset.x), static_cast<int32_t>(region.dst.offset.y), static_cast<int32_t>(region.dst.offset.z) };
+        copy.extent = textureRegionExtent(srcTexture, region.src);
+        copies.push_back(copy);
+    }
 
-    transitionImageLayout(vulkanDevice, cb->commandBuffer, texture, VK_IMAGE_LAYOUT_GENERAL);
-    vulkanDevice->dispatchTable.cmdCopyImageToBuffer(cb->commandBuffer, texture->image, VK_IMAGE_LAYOUT_GENERAL, dst.buffer, 1, &region);
+    VkCopyImageInfo2 copyInfo = {};
+    copyInfo.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2;
+    copyInfo.srcImage = srcTexture->image;
+    copyInfo.srcImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    copyInfo.dstImage = destTexture->image;
+    copyInfo.dstImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    copyInfo.regionCount = static_cast<uint32_t>(copies.size());
+    copyInfo.pRegions = copies.data();
+
+    transitionImageLayout(vulkanDevice, cb->commandBuffer, srcTexture, VK_IMAGE_LAYOUT_GENERAL);
+    transitionImageLayout(vulkanDevice, cb->commandBuffer, destTexture, VK_IMAGE_LAYOUT_GENERAL);
+    vulkanDevice->dispatchTable.cmdCopyImage2(cb->commandBuffer, &copyInfo);
 }
 
 void gpuBlitTexture(GpuCommandBuffer cb, GpuTexture destTexture, GpuTexture srcTexture)
 {
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkImageBlit blit = {};
-    blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcSubresource.aspectMask = gpuFormatPrimaryAspect(srcTexture->desc.format);
     blit.srcSubresource.mipLevel = 0;
     blit.srcSubresource.baseArrayLayer = 0;
-    blit.srcSubresource.layerCount = 1;
+    blit.srcSubresource.layerCount = std::min(gpuTextureLayerCount(srcTexture->desc), gpuTextureLayerCount(destTexture->desc));
     blit.srcOffsets[0] = { 0, 0, 0 };
-    blit.srcOffsets[1] = { static_cast<int32_t>(srcTexture->desc.dimensions.x), static_cast<int32_t>(srcTexture->desc.dimensions.y), static_cast<int32_t>(srcTexture->desc.dimensions.z) };
-    blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    blit.srcOffsets[1] = gpuTextureExtentOffset(srcTexture->desc);
+    blit.dstSubresource.aspectMask = gpuFormatPrimaryAspect(destTexture->desc.format);
     blit.dstSubresource.mipLevel = 0;
     blit.dstSubresource.baseArrayLayer = 0;
-    blit.dstSubresource.layerCount = 1;
+    blit.dstSubresource.layerCount = blit.srcSubresource.layerCount;
     blit.dstOffsets[0] = { 0, 0, 0 };
-    blit.dstOffsets[1] = { static_cast<int32_t>(destTexture->desc.dimensions.x), static_cast<int32_t>(destTexture->desc.dimensions.y), static_cast<int32_t>(destTexture->desc.dimensions.z) };
+    blit.dstOffsets[1] = gpuTextureExtentOffset(destTexture->desc);
 
     transitionImageLayout(vulkanDevice, cb->commandBuffer, srcTexture, VK_IMAGE_LAYOUT_GENERAL);
     transitionImageLayout(vulkanDevice, cb->commandBuffer, destTexture, VK_IMAGE_LAYOUT_GENERAL);
@@ -2183,6 +3452,133 @@ void gpuBlitTexture(GpuCommandBuffer cb, GpuTexture destTexture, GpuTexture srcT
         VK_FILTER_NEAREST);
 }
 
+// Fills mips 1..N-1 from mip 0 with a chain of linear blits, all layers at
+// once. Blits filter sRGB formats in linear space and round odd (NPOT) sizes
+// down, so any level count works. Each level is barriered from write to read
+// before it feeds the next. The texture needs TRANSFER_SRC | TRANSFER_DST;
+// formats without linear filtering fall back to nearest. Follow with
+// gpuBarrier(STAGE_TRANSFER, ...) before sampling, as with other copies.
+bool gpuGenerateMipsSupported(GpuDevice device, FORMAT format)
+{
+    VulkanDevice* vulkanDevice = device->vulkanDevice;
+    VkFormat vkFormat = gpuFormatToVkFormat(format);
+    if (vkFormat == VK_FORMAT_UNDEFINED)
+    {
+        return false;
+    }
+
+    VkFormatProperties formatProperties = {};
+    vulkanDevice->inst->instanceDispatchTable.getPhysicalDeviceFormatProperties(vulkanDevice->physicalDevice, vkFormat, &formatProperties);
+
+    // Block-compressed formats (and depth on many drivers) can't be blitted;
+    // their mips have to be uploaded.
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    return (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+}
+
+void gpuGenerateMips(GpuCommandBuffer cb, GpuTexture texture)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    const GpuTextureDesc& desc = texture->desc;
+    if (desc.mipCount <= 1)
+    {
+        return;
+    }
+
+    if (!gpuGenerateMipsSupported(cb->device, desc.format))
+    {
+        fprintf(stderr, "NoGraphicsAPI: gpuGenerateMips: format %d can't be blitted on this device; upload its mips instead\n", static_cast<int>(desc.format));
+        assert(false && "gpuGenerateMips: format can't be blitted");
+        return;
+    }
+
+    VkFormatProperties formatProperties = {};
+    vulkanDevice->inst->instanceDispatchTable.getPhysicalDeviceFormatProperties(vulkanDevice->physicalDevice, gpuFormatToVkFormat(desc.format), &formatProperties);
+
+    // Depth/stencil blits must use nearest filtering
+    const bool color = gpuFormatAspectMask(desc.format) == VK_IMAGE_ASPECT_COLOR_BIT;
+    const bool linear = formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    const VkFilter filter = color && linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    transitionImageLayout(vulkanDevice, cb->commandBuffer, texture, VK_IMAGE_LAYOUT_GENERAL);
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture->image;
+    barrier.subresourceRange.aspectMask = gpuFormatAspectMask(desc.format);
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    // Mip 0 may have just been written by any earlier command (copy, render,
+    // compute).
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vulkanDevice->dispatchTable.cmdPipelineBarrier(
+        cb->commandBuffer,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, nullptr,
+        0, nullptr,
+        1, &barrier);
+
+    const uint32_t layerCount = gpuTextureLayerCount(desc);
+    VkOffset3D srcSize = gpuTextureExtentOffset(desc);
+    for (uint32_t mip = 1; mip < desc.mipCount; mip++)
+    {
+        VkOffset3D dstSize = {
+            std::max(srcSize.x / 2, 1),
+            std::max(srcSize.y / 2, 1),
+            std::max(srcSize.z / 2, 1)
+        };
+
+        VkImageBlit blit = {};
+        blit.srcSubresource.aspectMask = gpuFormatPrimaryAspect(desc.format);
+        blit.srcSubresource.mipLevel = mip - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = layerCount;
+        blit.srcOffsets[0] = { 0, 0, 0 };
+        blit.srcOffsets[1] = srcSize;
+        blit.dstSubresource = blit.srcSubresource;
+        blit.dstSubresource.mipLevel = mip;
+        blit.dstOffsets[0] = { 0, 0, 0 };
+        blit.dstOffsets[1] = dstSize;
+
+        vulkanDevice->dispatchTable.cmdBlitImage(
+            cb->commandBuffer,
+            texture->image,
+            VK_IMAGE_LAYOUT_GENERAL,
+            texture->image,
+            VK_IMAGE_LAYOUT_GENERAL,
+            1,
+            &blit,
+            filter);
+
+        if (mip + 1 < desc.mipCount)
+        {
+            barrier.subresourceRange.baseMipLevel = mip;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            vulkanDevice->dispatchTable.cmdPipelineBarrier(
+                cb->commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+        }
+
+        srcSize = dstSize;
+    }
+}
+
 void gpuSetActiveTextureHeapPtr(GpuCommandBuffer cb, void* ptrGpu)
 {
     GpuDevice device = cb->device;
@@ -2200,6 +3596,7 @@ void gpuSetActiveTextureHeapPtr(GpuCommandBuffer cb, void* ptrGpu)
         // patch concurrently would race these buffers on the GPU — see
         // docs/multithreading.md.
         GpuPipeline currentPipeline = cb->currentPipeline;
+        const bool skipWork = cb->skipWork;
 
         auto patchedDescriptorDataGpu = gpuHostToDevicePointer(device, vulkanDevice->patchedDescriptorDataCpu);
         auto rwPatchedDescriptorDataGpu = gpuHostToDevicePointer(device, vulkanDevice->rwPatchedDescriptorDataCpu);
@@ -2224,7 +3621,17 @@ void gpuSetActiveTextureHeapPtr(GpuCommandBuffer cb, void* ptrGpu)
         address = reinterpret_cast<VkDeviceAddress>(patchedDescriptorDataGpu);
         rwAddress = reinterpret_cast<VkDeviceAddress>(rwPatchedDescriptorDataGpu);
 
-        gpuSetPipeline(cb, currentPipeline);
+        // The patch pipeline only displaced the compute bind point; graphics
+        // pipelines and their dynamic state are untouched.
+        if (currentPipeline && currentPipeline->bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE)
+        {
+            gpuSetPipeline(cb, currentPipeline);
+        }
+        else
+        {
+            cb->currentPipeline = currentPipeline;
+            cb->skipWork = skipWork;
+        }
     }
     else
     {
@@ -2316,8 +3723,12 @@ void gpuBarrier(GpuCommandBuffer cb, STAGE before, STAGE after, HAZARD_FLAGS haz
         case STAGE_RASTER_COLOR_OUT:
             return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
         case STAGE_ACCELERATION_STRUCTURE_BUILD:
+            // Builds also read shader-written inputs (e.g. GPU-produced
+            // instance arrays) and, for indirect builds, their ranges.
             return VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR |
-                   VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+                   VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR |
+                   VK_ACCESS_SHADER_READ_BIT |
+                   VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
         default:
             return VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
         }
@@ -2387,15 +3798,102 @@ void gpuWaitBefore(GpuCommandBuffer cb, STAGE after, void* ptrGpu, uint64_t valu
     // TODO: implement
 }
 
+// A pipeline still compiling (gpuCreate*PipelineAsync) binds its fallback if
+// that one is ready; otherwise the dispatches and draws recorded until the
+// next gpuSetPipeline are skipped.
 void gpuSetPipeline(GpuCommandBuffer cb, GpuPipeline pipeline)
 {
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    cb->currentPipeline = pipeline;
+    cb->skipWork = false;
+
+    GpuPipeline bound = pipeline;
+    if (!gpuPipelineReady(pipeline))
+    {
+        bound = pipeline->fallback;
+        if (!bound || !gpuPipelineReady(bound))
+        {
+            cb->skipWork = true;
+            return;
+        }
+    }
+
     vulkanDevice->dispatchTable.cmdBindPipeline(
         cb->commandBuffer,
-        pipeline->bindPoint,
-        pipeline->pipeline);
+        bound->bindPoint,
+        bound->pipeline);
 
-    cb->currentPipeline = pipeline;
+    if (bound->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+    {
+        gpuSetCullMode(cb, bound->cull);
+        if (vulkanDevice->dynamicPolygonMode)
+        {
+            gpuSetFillMode(cb, bound->fillMode);
+        }
+        gpuSetLineWidth(cb, 1.0f);
+        if (!bound->meshlet)
+        {
+            vulkanDevice->dispatchTable.cmdSetPrimitiveTopology(cb->commandBuffer, gpuTopologyToVkTopology(bound->topology));
+            vulkanDevice->dispatchTable.cmdSetPrimitiveRestartEnable(cb->commandBuffer, bound->primitiveRestart ? VK_TRUE : VK_FALSE);
+        }
+    }
+}
+
+void gpuSetCullMode(GpuCommandBuffer cb, CULL cull)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    vulkanDevice->dispatchTable.cmdSetCullMode(cb->commandBuffer, gpuCullToVkCullMode(cull));
+    vulkanDevice->dispatchTable.cmdSetFrontFace(cb->commandBuffer, gpuCullToVkFrontFace(cull));
+}
+
+void gpuSetTopology(GpuCommandBuffer cb, TOPOLOGY topology)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    if (cb->currentPipeline && cb->currentPipeline->meshlet)
+    {
+        return;
+    }
+    vulkanDevice->dispatchTable.cmdSetPrimitiveTopology(cb->commandBuffer, gpuTopologyToVkTopology(topology));
+}
+
+void gpuSetPrimitiveRestart(GpuCommandBuffer cb, bool enable)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    if (cb->currentPipeline && cb->currentPipeline->meshlet)
+    {
+        return;
+    }
+    vulkanDevice->dispatchTable.cmdSetPrimitiveRestartEnable(cb->commandBuffer, enable ? VK_TRUE : VK_FALSE);
+}
+
+bool gpuDynamicFillModeSupported(GpuDevice device)
+{
+    return device->vulkanDevice->dynamicPolygonMode;
+}
+
+void gpuSetFillMode(GpuCommandBuffer cb, FILL_MODE mode)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    if (!vulkanDevice->dynamicPolygonMode)
+    {
+        // The bound pipeline's own mode is baked in; any other needs a
+        // pipeline created with it.
+        if (!cb->currentPipeline || cb->currentPipeline->fillMode != mode)
+        {
+            fprintf(stderr, "NoGraphicsAPI: gpuSetFillMode: fill mode %d differs from the pipeline's and the device can't change it dynamically; create a pipeline with GpuRasterDesc::fillMode instead\n", static_cast<int>(mode));
+            assert(false && "gpuSetFillMode: dynamic fill mode unsupported");
+        }
+        return;
+    }
+    vulkanDevice->dispatchTable.cmdSetPolygonModeEXT(cb->commandBuffer, gpuFillModeToVkPolygonMode(mode));
+}
+
+void gpuSetLineWidth(GpuCommandBuffer cb, float width)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    const float* range = vulkanDevice->physicalDeviceProperties2.properties.limits.lineWidthRange;
+    width = vulkanDevice->wideLines ? std::clamp(width, range[0], range[1]) : 1.0f;
+    vulkanDevice->dispatchTable.cmdSetLineWidth(cb->commandBuffer, width);
 }
 
 void gpuSetDepthStencilState(GpuCommandBuffer cb, GpuDepthStencilState state)
@@ -2418,8 +3916,13 @@ void gpuSetDepthStencilState(GpuCommandBuffer cb, GpuDepthStencilState state)
         vulkanDevice->dispatchTable.cmdSetDepthBias(cmd, desc.depthBias, desc.depthBiasClamp, desc.depthBiasSlopeFactor);
     }
 
-    // Stencil state
-    bool stencilEnabled = desc.stencilFront.test != OP_ALWAYS || desc.stencilBack.test != OP_ALWAYS;
+    // Stencil state. A test of ALWAYS still needs the stencil test on when an
+    // op writes the mask.
+    auto stencilActive = [](const Stencil& face)
+    {
+        return face.test != OP_ALWAYS || face.failOp != OP_KEEP || face.passOp != OP_KEEP || face.depthFailOp != OP_KEEP;
+    };
+    bool stencilEnabled = stencilActive(desc.stencilFront) || stencilActive(desc.stencilBack);
     vulkanDevice->dispatchTable.cmdSetStencilTestEnable(cmd, stencilEnabled ? VK_TRUE : VK_FALSE);
 
     if (stencilEnabled)
@@ -2450,6 +3953,10 @@ void gpuSetBlendState(GpuCommandBuffer cb, GpuBlendState state)
 
 void gpuDispatch(GpuCommandBuffer cb, void* dataGpu, uint3 gridDimensions)
 {
+    if (cb->skipWork)
+    {
+        return;
+    }
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkDeviceAddress address = reinterpret_cast<VkDeviceAddress>(dataGpu);
     vulkanDevice->dispatchTable.cmdPushConstants(
@@ -2469,6 +3976,10 @@ void gpuDispatch(GpuCommandBuffer cb, void* dataGpu, uint3 gridDimensions)
 
 void gpuDispatchIndirect(GpuCommandBuffer cb, void* dataGpu, void* gridDimensionsGpu)
 {
+    if (cb->skipWork)
+    {
+        return;
+    }
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkDeviceAddress address = reinterpret_cast<VkDeviceAddress>(dataGpu);
     vulkanDevice->dispatchTable.cmdPushConstants(
@@ -2487,6 +3998,11 @@ void gpuDispatchIndirect(GpuCommandBuffer cb, void* dataGpu, void* gridDimension
         reinterpret_cast<VkDeviceAddress>(gridDimensionsGpu) - grid.address);
 }
 
+static VkImageView textureAttachmentView(GpuTexture texture)
+{
+    return texture->attachmentView != VK_NULL_HANDLE ? texture->attachmentView : texture->view;
+}
+
 void gpuBeginRenderPass(GpuCommandBuffer cb, GpuRenderPassDesc desc)
 {
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
@@ -2502,10 +4018,24 @@ void gpuBeginRenderPass(GpuCommandBuffer cb, GpuRenderPassDesc desc)
     {
         transitionImageLayout(vulkanDevice, cb->commandBuffer, desc.depthStencilTarget, VK_IMAGE_LAYOUT_GENERAL);
     }
+    for (const auto& resolveTarget : desc.resolveTargets)
+    {
+        if (resolveTarget != nullptr)
+        {
+            transitionImageLayout(vulkanDevice, cb->commandBuffer, resolveTarget, VK_IMAGE_LAYOUT_GENERAL);
+        }
+    }
+    if (desc.depthStencilResolveTarget != nullptr)
+    {
+        transitionImageLayout(vulkanDevice, cb->commandBuffer, desc.depthStencilResolveTarget, VK_IMAGE_LAYOUT_GENERAL);
+    }
 
+    assert(desc.resolveTargets.empty() || desc.resolveTargets.size() == desc.colorTargets.size());
     std::vector<VkRenderingAttachmentInfo> colorAttachments;
-    for (const auto& colorTarget : desc.colorTargets)
+    for (size_t i = 0; i < desc.colorTargets.size(); i++)
     {
+        GpuTexture colorTarget = desc.colorTargets[i];
+        GpuTexture resolveTarget = i < desc.resolveTargets.size() ? desc.resolveTargets[i] : nullptr;
         VkRenderingAttachmentInfo colorAttachment = {};
         colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
         colorAttachment.imageView = colorTarget->view;
@@ -2513,42 +4043,119 @@ void gpuBeginRenderPass(GpuCommandBuffer cb, GpuRenderPassDesc desc)
         colorAttachment.loadOp = desc.loadOp == LOAD_OP_LOAD ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.clearValue.color = { 0.0f, 0.0f, 0.0f, 1.0f };
+        if (resolveTarget != nullptr)
+        {
+            assert(colorTarget->desc.sampleCount > 1 && resolveTarget->desc.sampleCount == 1);
+            colorAttachment.resolveMode = gpuResolveToVkResolveMode(desc.colorResolve);
+            colorAttachment.resolveImageView = resolveTarget->view;
+            colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            if (colorTarget->desc.usage & USAGE_TRANSIENT)
+            {
+                colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+        }
         colorAttachments.push_back(colorAttachment);
     }
 
+    // A combined depth/stencil texture binds the same view to both slots.
+    const FORMAT depthStencilFormat = desc.depthStencilTarget != nullptr ? desc.depthStencilTarget->desc.format : FORMAT_NONE;
+    const bool hasDepth = gpuFormatHasDepth(depthStencilFormat);
+    const bool hasStencil = gpuFormatHasStencil(depthStencilFormat);
+    const VkImageView depthStencilView = desc.depthStencilTarget != nullptr ? textureAttachmentView(desc.depthStencilTarget) : VK_NULL_HANDLE;
+    const bool transientDepthStencil = desc.depthStencilTarget != nullptr && (desc.depthStencilTarget->desc.usage & USAGE_TRANSIENT);
+    const VkImageView depthStencilResolveView = desc.depthStencilResolveTarget != nullptr ? textureAttachmentView(desc.depthStencilResolveTarget) : VK_NULL_HANDLE;
+    const VkPhysicalDeviceDepthStencilResolveProperties& resolveProperties = vulkanDevice->depthStencilResolveProperties;
+    const VkResolveModeFlagBits depthResolveMode = gpuResolveToVkResolveMode(desc.depthResolve);
+    // Stencil resolves SAMPLE_ZERO (the one mode every device supports).
+    // Without independentResolve both aspects of a depth/stencil target must
+    // use the same mode, so stencil follows depth when it can (MIN/MAX);
+    // independentResolveNone only lets one aspect skip, which would drop it.
+    VkResolveModeFlagBits stencilResolveMode = VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+    if (hasDepth && hasStencil && depthResolveMode != stencilResolveMode && resolveProperties.independentResolve == VK_FALSE)
+    {
+        stencilResolveMode = depthResolveMode;
+    }
+    if (depthStencilResolveView != VK_NULL_HANDLE)
+    {
+        const bool depthSupported = !hasDepth || (resolveProperties.supportedDepthResolveModes & depthResolveMode);
+        const bool stencilSupported = !hasStencil || (resolveProperties.supportedStencilResolveModes & stencilResolveMode);
+        if (!depthSupported || !stencilSupported)
+        {
+            fprintf(stderr, "NoGraphicsAPI: depthResolve %d is not supported for this depth/stencil target on this device\n", static_cast<int>(desc.depthResolve));
+        }
+        assert(depthSupported && stencilSupported);
+    }
+
     VkRenderingAttachmentInfo depthAttachment = {};
-    if (desc.depthStencilTarget != nullptr)
+    if (hasDepth)
     {
         depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-        depthAttachment.imageView = desc.depthStencilTarget->view;
+        depthAttachment.imageView = depthStencilView;
         depthAttachment.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+        if (depthStencilResolveView != VK_NULL_HANDLE)
+        {
+            depthAttachment.resolveMode = depthResolveMode;
+            depthAttachment.resolveImageView = depthStencilResolveView;
+            depthAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            if (transientDepthStencil)
+            {
+                depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+        }
     }
 
-    auto& colorTarget = desc.colorTargets[0];
-    renderingInfo.renderArea.extent = { colorTarget->desc.dimensions.x, colorTarget->desc.dimensions.y };
-    renderingInfo.layerCount = 1;
+    VkRenderingAttachmentInfo stencilAttachment = {};
+    if (hasStencil)
+    {
+        stencilAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+        stencilAttachment.imageView = depthStencilView;
+        stencilAttachment.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        stencilAttachment.loadOp = desc.stencilLoadOp == LOAD_OP_LOAD ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        stencilAttachment.storeOp = desc.stencilStoreOp == STORE_OP_STORE ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        stencilAttachment.clearValue.depthStencil = { 1.0f, desc.clearStencil };
+        if (depthStencilResolveView != VK_NULL_HANDLE)
+        {
+            stencilAttachment.resolveMode = stencilResolveMode;
+            stencilAttachment.resolveImageView = depthStencilResolveView;
+            stencilAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            if (transientDepthStencil)
+            {
+                stencilAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+        }
+    }
+
+    // Depth-only passes (shadow maps, cascades) size the area from the depth target.
+    GpuTexture areaTarget = !desc.colorTargets.empty() ? desc.colorTargets[0] : desc.depthStencilTarget;
+    renderingInfo.renderArea.extent = { areaTarget->desc.dimensions.x, areaTarget->desc.dimensions.y };
+    // With a viewMask, every draw is broadcast to the views (layers) it names
+    // and layerCount is ignored; otherwise shaders pick among layerCount
+    // layers through SV_RenderTargetArrayIndex.
+    assert(desc.viewMask == 0 || desc.viewMask < (1ull << gpuMaxViewCount(cb->device)));
+    renderingInfo.viewMask = desc.viewMask;
+    renderingInfo.layerCount = desc.layerCount;
     renderingInfo.colorAttachmentCount = desc.colorTargets.size();
     renderingInfo.pColorAttachments = colorAttachments.data();
-    renderingInfo.pDepthAttachment = desc.depthStencilTarget != nullptr ? &depthAttachment : nullptr;
-    renderingInfo.pStencilAttachment = nullptr; // TODO: separate stencil support if needed
+    renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+    renderingInfo.pStencilAttachment = hasStencil ? &stencilAttachment : nullptr;
 
     vulkanDevice->dispatchTable.cmdBeginRendering(cb->commandBuffer, &renderingInfo);
 
     VkViewport viewport = {};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.width = static_cast<float>(colorTarget->desc.dimensions.x);
-    viewport.height = static_cast<float>(colorTarget->desc.dimensions.y);
+    viewport.width = static_cast<float>(areaTarget->desc.dimensions.x);
+    viewport.height = static_cast<float>(areaTarget->desc.dimensions.y);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
     vulkanDevice->dispatchTable.cmdSetViewport(cb->commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor = {};
     scissor.offset = { 0, 0 };
-    scissor.extent = { colorTarget->desc.dimensions.x, colorTarget->desc.dimensions.y };
+    scissor.extent = { areaTarget->desc.dimensions.x, areaTarget->desc.dimensions.y };
     vulkanDevice->dispatchTable.cmdSetScissor(cb->commandBuffer, 0, 1, &scissor);
 }
 
@@ -2560,6 +4167,10 @@ void gpuEndRenderPass(GpuCommandBuffer cb)
 
 void gpuDrawIndexedInstanced(GpuCommandBuffer cb, void* vertexDataGpu, void* pixelDataGpu, void* indicesGpu, uint32_t indexCount, uint32_t instanceCount)
 {
+    if (cb->skipWork)
+    {
+        return;
+    }
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkDeviceAddress pushConstants[3] = {
         reinterpret_cast<VkDeviceAddress>(vertexDataGpu),
@@ -2594,6 +4205,10 @@ void gpuDrawIndexedInstanced(GpuCommandBuffer cb, void* vertexDataGpu, void* pix
 
 void gpuDrawIndexedInstancedIndirect(GpuCommandBuffer cb, void* vertexDataGpu, void* pixelDataGpu, void* indicesGpu, void* argsGpu)
 {
+    if (cb->skipWork)
+    {
+        return;
+    }
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkDeviceAddress pushConstants[3] = {
         reinterpret_cast<VkDeviceAddress>(vertexDataGpu),
@@ -2637,6 +4252,10 @@ void gpuDrawIndexedInstancedIndirectMulti(
     void* argsGpu,
     void* drawCountGpu)
 {
+    if (cb->skipWork)
+    {
+        return;
+    }
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkDeviceAddress pushConstants[3] = {
         reinterpret_cast<VkDeviceAddress>(dataVxGpu),
@@ -2678,6 +4297,10 @@ void gpuDrawIndexedInstancedIndirectMulti(
 
 void gpuDrawMeshlets(GpuCommandBuffer cb, void* meshletDataGpu, void* pixelDataGpu, uint3 dim)
 {
+    if (cb->skipWork)
+    {
+        return;
+    }
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkDeviceAddress pushConstants[2] = {
         reinterpret_cast<VkDeviceAddress>(meshletDataGpu),
@@ -2701,6 +4324,10 @@ void gpuDrawMeshlets(GpuCommandBuffer cb, void* meshletDataGpu, void* pixelDataG
 
 void gpuDrawMeshletsIndirect(GpuCommandBuffer cb, void* meshletDataGpu, void* pixelDataGpu, void* dimGpu)
 {
+    if (cb->skipWork)
+    {
+        return;
+    }
     VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     VkDeviceAddress pushConstants[2] = {
         reinterpret_cast<VkDeviceAddress>(meshletDataGpu),
@@ -2776,6 +4403,10 @@ static void destroySwapchainResources(GpuSwapchain swapchain)
     }
     for (auto image : swapchain->images)
     {
+        for (auto& [key, view] : image->subViews)
+        {
+            vulkanDevice->dispatchTable.destroyImageView(view, nullptr);
+        }
         vulkanDevice->dispatchTable.destroyImageView(image->view, nullptr);
         delete image;
     }
@@ -3240,14 +4871,51 @@ GpuAccelerationStructure gpuCreateAccelerationStructure(GpuDevice device, GpuAcc
         as->buildRanges.push_back(vkRange);
     }
 
+    auto sizes = gpuAccelerationStructureSizes(device, desc);
+    as->buildScratchSize = sizes.buildScratchSize;
+    as->updateScratchSize = sizes.updateScratchSize;
+
     return as;
 }
 
-void gpuBuildAccelerationStructures(GpuCommandBuffer cb, Span<GpuAccelerationStructure> as, void* scratchGpu, MODE mode)
+// Scratch slices handed to a batched build are laid out back to back, each
+// rounded up to minAccelerationStructureScratchOffsetAlignment. The extra
+// (alignment - 1) bytes let the build align an arbitrary base pointer.
+static VkDeviceSize scratchAlignUp(VkDeviceSize value, VkDeviceSize align)
+{
+    return (value + align - 1) & ~(align - 1);
+}
+
+static VkDeviceSize scratchAlignment(VulkanDevice* vulkanDevice)
+{
+    return std::max<VkDeviceSize>(vulkanDevice->accelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment, 1);
+}
+
+size_t gpuAccelerationStructureScratchSize(Span<GpuAccelerationStructure> as, MODE mode)
+{
+    if (as.empty())
+    {
+        return 0;
+    }
+
+    VulkanDevice* vulkanDevice = as[0]->device->vulkanDevice;
+    VkDeviceSize align = scratchAlignment(vulkanDevice);
+    VkDeviceSize total = 0;
+    for (const auto& a : as)
+    {
+        VkDeviceSize size = (mode == MODE_UPDATE) ? a->updateScratchSize : a->buildScratchSize;
+        total += scratchAlignUp(size, align);
+    }
+    return total + align - 1;
+}
+
+// Points every structure at its own slice of scratchGpu and selects the
+// build mode. Shared by the direct and indirect batched builds.
+static std::vector<VkAccelerationStructureBuildGeometryInfoKHR> prepareBuildInfos(VulkanDevice* vulkanDevice, Span<GpuAccelerationStructure> as, void* scratchGpu, MODE mode)
 {
-    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
     std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos;
-    std::vector<VkAccelerationStructureBuildRangeInfoKHR*> buildRanges;
+    VkDeviceSize align = scratchAlignment(vulkanDevice);
+    VkDeviceAddress scratch = scratchAlignUp(reinterpret_cast<VkDeviceAddress>(scratchGpu), align);
     for (const auto& a : as)
     {
         if (mode == MODE_UPDATE)
@@ -3261,9 +4929,26 @@ void gpuBuildAccelerationStructures(GpuCommandBuffer cb, Span<GpuAccelerationStr
             a->buildInfo.srcAccelerationStructure = VK_NULL_HANDLE;
         }
 
-        a->buildInfo.scratchData.deviceAddress = reinterpret_cast<VkDeviceAddress>(scratchGpu);
+        a->buildInfo.scratchData.deviceAddress = scratch;
+        scratch += scratchAlignUp((mode == MODE_UPDATE) ? a->updateScratchSize : a->buildScratchSize, align);
 
         buildInfos.push_back(a->buildInfo);
+    }
+    return buildInfos;
+}
+
+// Every structure in the batch gets its own slice of scratchGpu, so the whole
+// batch is a single vkCmdBuildAccelerationStructuresKHR with no barriers in
+// between. The range must hold gpuAccelerationStructureScratchSize(as, mode)
+// bytes. Structures in one batch must not depend on each other (e.g. a TLAS
+// referencing a BLAS built in the same call).
+void gpuBuildAccelerationStructures(GpuCommandBuffer cb, Span<GpuAccelerationStructure> as, void* scratchGpu, MODE mode)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    auto buildInfos = prepareBuildInfos(vulkanDevice, as, scratchGpu, mode);
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR*> buildRanges;
+    for (const auto& a : as)
+    {
         buildRanges.push_back(a->buildRanges.data());
     }
 
@@ -3274,6 +4959,65 @@ void gpuBuildAccelerationStructures(GpuCommandBuffer cb, Span<GpuAccelerationStr
         buildRanges.data());
 }
 
+static_assert(sizeof(GpuAccelerationStructureBuildRange) == sizeof(VkAccelerationStructureBuildRangeInfoKHR),
+              "GpuAccelerationStructureBuildRange must match VkAccelerationStructureBuildRangeInfoKHR");
+
+// Ranges are read on the GPU: one GpuAccelerationStructureBuildRange per
+// geometry, packed back to back in batch order. The ranges given at creation
+// are the upper bounds. Without accelerationStructureIndirectBuild the batch
+// is built directly with those upper bounds, so GPU producers must leave
+// unused slots inactive (a null blasAddress for instances).
+void gpuBuildAccelerationStructuresIndirect(GpuCommandBuffer cb, Span<GpuAccelerationStructure> as, void* scratchGpu, void* rangesGpu, MODE mode)
+{
+    VulkanDevice* vulkanDevice = cb->device->vulkanDevice;
+    if (!vulkanDevice->accelerationStructureIndirectBuild)
+    {
+        gpuBuildAccelerationStructures(cb, as, scratchGpu, mode);
+        return;
+    }
+
+    auto buildInfos = prepareBuildInfos(vulkanDevice, as, scratchGpu, mode);
+    std::vector<VkDeviceAddress> indirectAddresses;
+    std::vector<uint32_t> indirectStrides;
+    std::vector<std::vector<uint32_t>> maxPrimitiveCounts;
+    std::vector<const uint32_t*> maxPrimitiveCountPtrs;
+    VkDeviceAddress ranges = reinterpret_cast<VkDeviceAddress>(rangesGpu);
+    for (const auto& a : as)
+    {
+        indirectAddresses.push_back(ranges);
+        indirectStrides.push_back(sizeof(VkAccelerationStructureBuildRangeInfoKHR));
+        ranges += a->buildRanges.size() * sizeof(VkAccelerationStructureBuildRangeInfoKHR);
+
+        std::vector<uint32_t> counts;
+        for (const auto& range : a->buildRanges)
+        {
+            counts.push_back(range.primitiveCount);
+        }
+        maxPrimitiveCounts.push_back(std::move(counts));
+    }
+    for (const auto& counts : maxPrimitiveCounts)
+    {
+        maxPrimitiveCountPtrs.push_back(counts.data());
+    }
+
+    vulkanDevice->dispatchTable.cmdBuildAccelerationStructuresIndirectKHR(
+        cb->commandBuffer,
+        as.size(),
+        buildInfos.data(),
+        indirectAddresses.data(),
+        indirectStrides.data(),
+        maxPrimitiveCountPtrs.data());
+}
+
+void* gpuAccelerationStructureAddress(GpuAccelerationStructure as)
+{
+    VulkanDevice* vulkanDevice = as->device->vulkanDevice;
+    VkAccelerationStructureDeviceAddressInfoKHR addressInfo = {};
+    addressInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+    addressInfo.accelerationStructure = as->buildInfo.dstAccelerationStructure;
+    return reinterpret_cast<void*>(vulkanDevice->dispatchTable.getAccelerationStructureDeviceAddressKHR(&addressInfo));
+}
+
 void gpuDestroyAccelerationStructure(GpuAccelerationStructure as)
 {
     VulkanDevice* vulkanDevice = as->device->vulkanDevice;
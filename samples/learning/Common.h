@@ -3,34 +3,165 @@
 
 #include "NoGraphicsAPI.h"
 
+// Element types. 16-bit tensors pack two elements into each 32-bit word,
+// element i in the low half of word i / 2 when i is even. Kernels widen them
+// to fp32 on load and accumulate in fp32.
+#define TENSOR_DTYPE_F32 0
+#define TENSOR_DTYPE_F16 1
+#define TENSOR_DTYPE_BF16 2
+
 struct alignas(16) TensorData
 {
     uint64_t n; // number of elements in x and z
     uint64_t m; // number of elements in y (m <= n)
-    float a;    // leaky relu alpha
+    float a;    // leaky relu alpha, _fill value
     float* x;   // input
     float* y;   // input (grad in _relu_backard)
     float* z;   // output
 };
 
-struct alignas(16) TensorTransposeData
+// _random distributions. Element i of a draw is generated from Philox4x32-10
+// with counter offset + i and key seed, so any element can be produced on
+// its own and successive draws never reuse a counter.
+#define TENSOR_RANDOM_UNIFORM 0   // [a, b)
+#define TENSOR_RANDOM_NORMAL 1    // mean a, standard deviation b
+#define TENSOR_RANDOM_BERNOULLI 2 // 1 with probability a, else 0
+
+struct alignas(16) TensorRandomData
 {
-    uint64_t n; // number of elements in x and y
-    uint64_t r; // number of rows
-    uint64_t c; // number of columns
-    float* x;   // input
-    float* y;   // output
+    uint64_t n;            // number of elements in z
+    uint64_t seed;         // Philox key
+    uint64_t offset;       // Philox counter of element 0
+    uint32_t distribution; // TENSOR_RANDOM_*
+    float a;
+    float b;
+    float* z; // output
+};
+
+// _convert: each thread converts a pair of elements, so no two threads write
+// the same word of a 16-bit output
+struct alignas(16) TensorConvertData
+{
+    uint64_t n;    // number of elements in x and z
+    uint32_t from; // TENSOR_DTYPE_* of x
+    uint32_t to;   // TENSOR_DTYPE_* of z
+    float* x;      // input
+    float* z;      // output
+};
+
+// _reduce ops and group size. Each pass folds up to TENSOR_REDUCE_GROUP *
+// groups elements into one partial per group; Tensor::reduce chains passes
+// until a single value is left.
+#define TENSOR_REDUCE_SUM 0
+#define TENSOR_REDUCE_DOT 1
+#define TENSOR_REDUCE_MAX 2
+#define TENSOR_REDUCE_GROUP 256
+#define TENSOR_REDUCE_MAX_GROUPS 1024
+
+struct alignas(16) TensorReduceData
+{
+    uint64_t n;      // number of elements in x (and y)
+    uint64_t grid;   // number of threads in the dispatch (grid-stride loop)
+    uint32_t op;     // TENSOR_REDUCE_*
+    float scale;     // applied to each partial (1/n for mean on the last pass)
+    uint32_t xdtype; // TENSOR_DTYPE_* of x
+    uint32_t ydtype; // TENSOR_DTYPE_* of y
+    float* x;        // input
+    float* y;        // input (TENSOR_REDUCE_DOT only)
+    float* z;        // output, one partial per group
+};
+
+// _contiguous gathers a strided view (mT, slices of it) into row-major order
+#define TENSOR_MAX_DIMS 8
+
+struct alignas(16) TensorLayoutData
+{
+    uint64_t n;                        // number of elements in the view
+    uint64_t strides[TENSOR_MAX_DIMS]; // view strides, in elements
+    float* x;                          // input (first element of the view)
+    float* y;                          // output
+    uint32_t shape[TENSOR_MAX_DIMS];   // view shape
+    uint32_t rank;                     // number of dimensions
+    uint32_t dtype;                    // TENSOR_DTYPE_* of x, y is always fp32
 };
 
+// Tiled matmul kernels: 16x16 threads per group; _matmul_tile64 computes a
+// 64x64 block (4x4 per thread), _matmul_tile16 a 16x16 block. Both stage
+// TENSOR_MATMUL_TILE_K-deep slices of x and y through groupshared memory.
+// The dispatch's z dimension is the batch.
+#define TENSOR_MATMUL_TILE_K 16
+
+// _matmul_splitk serves thin outputs (fewer than 16 rows or columns, GEMV):
+// a 16x16 group computes 16 consecutive outputs, its 16 rows of threads
+// striding over one k-long slice of the inner dimension; dispatch y picks the
+// slice. With more than one slice z holds a partial per slice and output,
+// z[slice * n + output], which a second pass sums. Slices are at least
+// TENSOR_MATMUL_SPLIT_K long, and only added until the dispatch has about
+// TENSOR_MATMUL_SPLIT_GROUPS groups.
+#define TENSOR_MATMUL_SPLIT_K 1024
+#define TENSOR_MATMUL_SPLIT_GROUPS 512
+
 struct alignas(16) TensorMatMulData
 {
-    uint64_t n; // number of elements in z
-    uint64_t a; // number of rows in x
-    uint64_t b; // number of columns in x, number of rows in y
-    uint64_t c; // number of columns in y
-    float* x;   // input
-    float* y;   // input
-    float* z;   // output
+    uint64_t n;      // number of elements in z, all batches (z matrices are a * c apart)
+    uint64_t a;      // number of rows in x
+    uint64_t b;      // number of columns in x, number of rows in y
+    uint64_t c;      // number of columns in y
+    uint64_t sx;     // elements between consecutive x matrices of a batch, 0 broadcasts one x
+    uint64_t sy;     // elements between consecutive y matrices of a batch, 0 broadcasts one y
+    uint64_t k;      // _matmul_splitk: length of the k slice per dispatch row
+    uint32_t tx;     // x is stored transposed, as a (b, a) matrix
+    uint32_t ty;     // y is stored transposed, as a (c, b) matrix
+    uint32_t xdtype; // TENSOR_DTYPE_* of x (z is always fp32)
+    uint32_t ydtype; // TENSOR_DTYPE_* of y
+    float* x;        // input
+    float* y;        // input
+    float* z;        // output
+};
+
+// _eval runs a small elementwise program per element: each instruction writes
+// register dst from registers a and b or its immediate. Built by Expr on the
+// host, which reuses a register once its value is dead; the backward pass is a
+// second program derived from the first. _eval8 and _eval32 keep a smaller
+// register file for programs that fit it.
+#define TENSOR_OP_LOAD 0  // inputs[a][t % m[a]]
+#define TENSOR_OP_CONST 1 // imm
+#define TENSOR_OP_ADD 2
+#define TENSOR_OP_SUB 3
+#define TENSOR_OP_MUL 4
+#define TENSOR_OP_DIV 5
+#define TENSOR_OP_POW 6
+#define TENSOR_OP_EXP 7
+#define TENSOR_OP_LOG 8
+#define TENSOR_OP_TANH 9
+#define TENSOR_OP_COSH 10
+#define TENSOR_OP_SINH 11
+#define TENSOR_OP_RELU 12 // a > 0 ? a : a * imm
+#define TENSOR_OP_STEP 13 // a > 0 ? 1 : imm
+
+#define TENSOR_PROGRAM_MAX_CODE 128 // also the register file of _eval
+#define TENSOR_PROGRAM_MAX_INPUTS 8
+#define TENSOR_PROGRAM_MAX_OUTPUTS 8
+
+struct TensorInstruction
+{
+    uint32_t op; // TENSOR_OP_*
+    uint32_t a;  // register, or input index for TENSOR_OP_LOAD
+    uint32_t b;  // register
+    float imm;
+    uint32_t dst; // register
+};
+
+struct alignas(16) TensorProgramData
+{
+    uint64_t n;        // number of elements in each output
+    uint32_t count;    // number of instructions
+    uint32_t outputs;  // number of outputs
+    uint64_t m[TENSOR_PROGRAM_MAX_INPUTS];         // number of elements in each input (m <= n)
+    float* inputs[TENSOR_PROGRAM_MAX_INPUTS];      // input
+    float* z[TENSOR_PROGRAM_MAX_OUTPUTS];          // output
+    uint32_t results[TENSOR_PROGRAM_MAX_OUTPUTS];  // register written to each output
+    TensorInstruction code[TENSOR_PROGRAM_MAX_CODE];
 };
 
 struct alignas(16) TensorAdamData
@@ -46,4 +177,38 @@ struct alignas(16) TensorAdamData
     float* adjustment; // output
 };
 
+// _step applies one optimizer update to every parameter of a model in a single
+// dispatch. Thread t updates element t - offset of the entry whose range
+// [offset, offset + n) holds t; entries are sorted by offset. With loss
+// scaling, grads are multiplied by scale first, and _step_check (run over the
+// same table) raises *overflow on any non-finite grad, which makes _step skip
+// the whole update.
+#define TENSOR_STEP_SGD 0
+#define TENSOR_STEP_ADAM 1
+
+struct TensorStepEntry
+{
+    uint64_t offset;  // first thread of this parameter
+    uint64_t n;       // number of elements
+    float* weights;   // input/output
+    float* grad;      // input
+    float* mean;      // input/output (TENSOR_STEP_ADAM only)
+    float* variance;  // input/output (TENSOR_STEP_ADAM only)
+};
+
+struct alignas(16) TensorStepData
+{
+    uint64_t n;        // number of elements across all entries
+    uint32_t entries;  // number of entries in table
+    uint32_t method;   // TENSOR_STEP_*
+    uint32_t step;     // 1-based step, for Adam's bias correction (less *skipped)
+    float lr;
+    float b1;
+    float b2;
+    float scale;       // applied to every grad, 1 / loss scale
+    TensorStepEntry* table;
+    float* overflow;   // 1 once a grad overflowed, nullptr when unchecked
+    float* skipped;    // steps skipped on overflow so far, nullptr when unchecked
+};
+
 #endif
\ No newline at end of file
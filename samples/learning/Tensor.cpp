@@ -1,6 +1,7 @@
 #include "Common.h"
 #include "Tensor.h"
 #include "Utilities.h"
+#include <cassert>
 #include <cstring>
 #include <map>
 #include <algorithm>
@@ -8,10 +9,12 @@
 #include <iostream>
 #include <set>
 #include <chrono>
+#include <cstdlib>
+#include <iterator>
 
 const uint64_t FRAMES_IN_FLIGHT = 2;
+const int TENSOR_STAGES = STAGE_COMPUTE + 1; // tensors are only touched by transfers and compute
 std::vector<Device*> devices;
-std::map<STAGE, std::set<Tensor>> tensors_pending_writes;
 
 std::string to_string(Shape shape)
 {
@@ -61,11 +64,121 @@ using ReadbackAllocator =
         StackAllocator<64 * 1024 * 1024, MEMORY_READBACK>,
         GpuMallocator<MEMORY_DEFAULT>>;
 
+// Tensor.spv kernels; Device_impl builds one pipeline per entry at creation.
+enum KERNEL
+{
+    KERNEL_ADD,
+    KERNEL_SUB,
+    KERNEL_MUL,
+    KERNEL_DIV,
+    KERNEL_CONVERT,
+    KERNEL_REDUCE,
+    KERNEL_CONTIGUOUS,
+    KERNEL_FILL,
+    KERNEL_RANDOM,
+    KERNEL_MATMUL,
+    KERNEL_MATMUL_SPLITK,
+    KERNEL_MATMUL_TILE16,
+    KERNEL_MATMUL_TILE64,
+    KERNEL_POW,
+    KERNEL_LOG,
+    KERNEL_COSH,
+    KERNEL_TANH,
+    KERNEL_RELU,
+    KERNEL_RELU_BACKWARD,
+    KERNEL_EVAL,
+    KERNEL_EVAL8,
+    KERNEL_EVAL32,
+    KERNEL_ADAM,
+    KERNEL_STEP,
+    KERNEL_STEP_CHECK,
+    KERNEL_COUNT
+};
+
+const char* const kernel_entries[] = {
+    "_add",
+    "_sub",
+    "_mul",
+    "_div",
+    "_convert",
+    "_reduce",
+    "_contiguous",
+    "_fill",
+    "_random",
+    "_matmul",
+    "_matmul_splitk",
+    "_matmul_tile16",
+    "_matmul_tile64",
+    "_pow",
+    "_log",
+    "_cosh",
+    "_tanh",
+    "_relu",
+    "_relu_backward",
+    "_eval",
+    "_eval8",
+    "_eval32",
+    "_adam",
+    "_step",
+    "_step_check",
+};
+static_assert(std::size(kernel_entries) == KERNEL_COUNT, "every KERNEL needs an entry point");
+
+static_assert(DTYPE_F32 == TENSOR_DTYPE_F32 && DTYPE_F16 == TENSOR_DTYPE_F16 && DTYPE_BF16 == TENSOR_DTYPE_BF16, "DTYPE is passed to the kernels as is");
+
+// Floats of storage for n elements of dtype, 16-bit types pack two per float.
+static uint64_t words(DTYPE dtype, uint64_t n)
+{
+    return dtype == DTYPE_F32 ? n : (n + 1) / 2;
+}
+
+// Names of the OpEntryPoint instructions in a SPIR-V module.
+static std::set<std::string> spirv_entry_points(const std::vector<uint8_t>& ir)
+{
+    std::set<std::string> entries;
+    auto code = reinterpret_cast<const uint32_t*>(ir.data());
+    size_t count = ir.size() / sizeof(uint32_t);
+    for (size_t i = 5; i < count;)
+    {
+        uint32_t opcode = code[i] & 0xffff;
+        uint32_t length = code[i] >> 16;
+        if (length == 0 || i + length > count)
+        {
+            break;
+        }
+        if (opcode == 15 && length > 3) // OpEntryPoint model id "name" interface...
+        {
+            auto name = reinterpret_cast<const char*>(code + i + 3);
+            entries.insert(std::string(name, strnlen(name, (length - 3) * sizeof(uint32_t))));
+        }
+        i += length;
+    }
+    return entries;
+}
+
 class Device_impl : public Device
 {
 public:
     Device_impl(int index)
     {
+        // check the kernels before creating anything, a stale Tensor.spv
+        // otherwise only fails at the first op that needs the missing one
+        auto tensorIR = loadIR("shaders/learning/Tensor.spv");
+        auto entries = spirv_entry_points(tensorIR);
+        std::string missing;
+        for (auto entry : kernel_entries)
+        {
+            if (entries.count(entry) == 0)
+            {
+                missing += std::string(" ") + entry;
+            }
+        }
+        if (!missing.empty())
+        {
+            auto error = "shaders/learning/Tensor.spv is missing kernels:" + missing;
+            throw std::runtime_error(error);
+        }
+
         device = gpuCreateDevice(index);
         queue = gpuCreateQueue(device);
 
@@ -77,21 +190,20 @@ public:
             readback_allocator[i] = new ReadbackAllocator(device);
         }
 
-        auto tensorIR = loadIR("shaders/learning/Tensor.spv");
-        pipelines["add"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_add");
-        pipelines["sub"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_sub");
-        pipelines["mul"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_mul");
-        pipelines["div"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_div");
-        pipelines["dot"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_dot");
-        pipelines["mT"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_mT");
-        pipelines["matmul"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_matmul");
-        pipelines["pow"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_pow");
-        pipelines["log"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_log");
-        pipelines["cosh"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_cosh");
-        pipelines["tanh"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_tanh");
-        pipelines["relu"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_relu");
-        pipelines["relu_backward"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_relu_backward");
-        pipelines["adam"] = gpuCreateComputePipeline(device, ByteSpan(tensorIR), "_adam");
+        std::vector<GpuComputePipelineDesc> descs;
+        for (auto entry : kernel_entries)
+        {
+            descs.push_back({ ByteSpan(tensorIR), entry });
+        }
+        gpuCreateComputePipelines(device, Span<GpuComputePipelineDesc>(descs), Span<GpuPipeline>(pipelines));
+
+        // TENSOR_MATMUL=naive forces the untiled kernel (tensorbench baseline)
+        auto matmul_kernel = std::getenv("TENSOR_MATMUL");
+        naive_matmul = matmul_kernel && std::string(matmul_kernel) == "naive";
+
+        // TENSOR_SEED=<n> makes rand/randn/bernoulli reproducible
+        auto seed_value = std::getenv("TENSOR_SEED");
+        seed(seed_value ? std::strtoull(seed_value, nullptr, 10) : std::random_device{}());
     }
 
     ~Device_impl()
@@ -111,7 +223,7 @@ public:
 
         gpuDestroyQueue(queue);
 
-        for (auto [entry, pipeline] : pipelines)
+        for (auto pipeline : pipelines)
         {
             gpuFreePipeline(pipeline);
         }
@@ -129,67 +241,87 @@ public:
         return Tensor(this, data, {}, shape);
     }
 
+    virtual void seed(uint64_t seed) override
+    {
+        random_seed = seed;
+        random_offset = 0;
+    }
+
     virtual Tensor rand(Shape shape) override
     {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::uniform_real_distribution<float> dis(0.f, 1.f);
+        return random(TENSOR_RANDOM_UNIFORM, 0.f, 1.f, shape);
+    }
 
-        std::vector<float> data(flatten(shape));
-        for (size_t i = 0; i < data.size(); i++)
-        {
-            data[i] = dis(gen);
-        }
+    virtual Tensor randn(Shape shape) override
+    {
+        return random(TENSOR_RANDOM_NORMAL, 0.f, 1.f, shape);
+    }
 
-        return Tensor(this, data, {}, shape);
+    virtual Tensor bernoulli(Shape shape, float p) override
+    {
+        return random(TENSOR_RANDOM_BERNOULLI, p, 0.f, shape);
     }
 
     virtual Tensor zeros(Shape shape) override
     {
-        std::vector<float> data(flatten(shape), 0.f);
-        return Tensor(this, data, {}, shape);
+        return repeat(0.f, shape);
     }
 
     virtual Tensor ones(Shape shape) override
     {
-        std::vector<float> data(flatten(shape), 1.f);
-        return Tensor(this, data, {}, shape);
+        return repeat(1.f, shape);
     }
 
     virtual Tensor repeat(float x, Shape shape) override
     {
-        std::vector<float> data(flatten(shape), x);
-        return Tensor(this, data, {}, shape);
-    }
+        auto size = flatten(shape);
+        auto allocation = floats(size);
+
+        auto tensor_data = struct_data<TensorData>();
+        tensor_data.cpu->n = size;
+        tensor_data.cpu->a = x;
+        tensor_data.cpu->z = allocation.gpu;
+
+        auto cmd = record();
+        gpuSetPipeline(cmd, pipelines[KERNEL_FILL]);
+        gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
+
+        auto out = Tensor(this, allocation, {}, shape);
+
+        written(STAGE_COMPUTE, { out });
 
-    virtual Tensor repeat(const Tensor& tensor, Shape shape) override
-    {
-        auto out = zeros(append(tensor._shape, shape));
-        repeat(out, tensor);
         return out;
     }
 
-    void repeat(Tensor dst, const Tensor& src)
+    // Each draw takes the next flatten(shape) Philox counters.
+    Tensor random(uint32_t distribution, float a, float b, Shape shape)
     {
-        if (dst._shape.empty())
-        {
-            auto error = "Unable to repeat copy to empty tensor";
-            throw std::runtime_error(error);
-        }
+        auto size = flatten(shape);
+        auto allocation = floats(size);
 
-        if (dst._shape != src._shape)
-        {
-            for (size_t i = 0; i < dst._shape.front(); i++)
-            {
-                repeat(dst[i], src);
-            }
-        }
-        else
-        {
-            dst.copy(src);
-        }
+        auto tensor_data = struct_data<TensorRandomData>();
+        tensor_data.cpu->n = size;
+        tensor_data.cpu->seed = random_seed;
+        tensor_data.cpu->offset = random_offset;
+        tensor_data.cpu->distribution = distribution;
+        tensor_data.cpu->a = a;
+        tensor_data.cpu->b = b;
+        tensor_data.cpu->z = allocation.gpu;
+        random_offset += size;
+
+        auto cmd = record();
+        gpuSetPipeline(cmd, pipelines[KERNEL_RANDOM]);
+        gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
+
+        auto out = Tensor(this, allocation, {}, shape);
+
+        written(STAGE_COMPUTE, { out });
+
+        return out;
     }
 
+    virtual Tensor repeat(const Tensor& tensor, Shape shape) override; // after ExprProgram
+
     uint64_t ring() const
     {
         return frame % FRAMES_IN_FLIGHT;
@@ -206,37 +338,35 @@ public:
     }
 
     template <typename T>
-    Allocation<T> struct_data()
+    Allocation<T> struct_data(size_t count = 1)
     {
-        auto alloc = struct_allocator[ring()]->allocate<T>(1);
+        auto alloc = struct_allocator[ring()]->allocate<T>(count);
 
         // submit command buffer if we run out of struct memory on the stack
         if (struct_allocator[ring()]->fallback_owns<T>(alloc))
         {
             struct_allocator[ring()]->free<T>(alloc);
             submit();
-            alloc = struct_allocator[ring()]->allocate<T>(1);
+            alloc = struct_allocator[ring()]->allocate<T>(count);
         }
 
         return alloc;
     }
 
-    void barrier(STAGE after, std::vector<Tensor> tensors)
-    {
-        for (auto iter = tensors_pending_writes.begin(); iter != tensors_pending_writes.end(); iter++)
-        {
-            auto stage = iter->first;
-            for (auto tensor : tensors)
-            {
-                if (tensors_pending_writes[stage].count(tensor) != 0)
-                {
-                    gpuBarrier(cmd, stage, after);
-                    tensors_pending_writes[stage].clear();
-                    break;
-                }
-            }
-        }
-    }
+    // Hazards are tracked per storage (views share it) with epochs: a barrier
+    // from stage b to stage a makes every use of stage b up to the current
+    // epoch visible to stage a, records that epoch in synced[b][a] and starts
+    // the next one. An access only needs a barrier when its storage was used
+    // after that, which is a couple of compares per tensor. One barrier call
+    // covers every pending write, so independent ops recorded back to back
+    // (e.g. two rand() chains) share barriers instead of each taking one.
+    //
+    // Call before recording a command that reads `reads` and writes `writes`
+    // in place at stage `after`; new outputs are stamped with written().
+    void barrier(STAGE after, const std::vector<Tensor>& reads, const std::vector<Tensor>& writes = {});
+
+    // Stamps the outputs of the command just recorded at `stage`.
+    void written(STAGE stage, const std::vector<Tensor>& tensors);
 
     GpuCommandBuffer record()
     {
@@ -318,28 +448,139 @@ public:
     StructAllocator* struct_allocator[FRAMES_IN_FLIGHT] = {};
     ReadbackAllocator* readback_allocator[FRAMES_IN_FLIGHT] = {};
     std::map<uint64_t, std::vector<Allocation<float>>> pending_free;
-    std::map<std::string, GpuPipeline> pipelines;
+    GpuPipeline pipelines[KERNEL_COUNT] = {};
+    bool naive_matmul = false;
+    uint64_t random_seed = 0;
+    uint64_t random_offset = 0;
+    uint64_t epoch = 1;
+    uint64_t last_use[TENSOR_STAGES] = {};
+    uint64_t synced[TENSOR_STAGES][TENSOR_STAGES] = {};
     std::map<uint64_t, std::vector<std::pair<Allocation<float>, std::function<void(std::vector<float>)>>>> cpu_callbacks;
 };
 
-class Tensor_impl
+// Device memory behind a tensor and all of its views (reshape, detach,
+// slices, mT); freed once the last of them is gone.
+class Tensor_storage
 {
 public:
-    ~Tensor_impl()
+    ~Tensor_storage()
     {
-        if (!_slice)
-        {
-            _device->free(_allocation);
-        }
+        _device->free(_allocation);
     }
     Device_impl* _device = nullptr;
     Allocation<float> _allocation;
-    bool _slice = false;
+    uint64_t write_epoch[TENSOR_STAGES] = {}; // last write per STAGE, see Device_impl::barrier
+    uint64_t read_epoch[TENSOR_STAGES] = {};  // last read per STAGE
+};
+
+class Tensor_impl
+{
+public:
+    Device_impl* _device = nullptr;
+    std::shared_ptr<Tensor_storage> _storage;
+    Allocation<float> _allocation;  // first element of this view in _storage
+    std::vector<uint64_t> _strides; // in elements, empty when row-major
+    DTYPE _dtype = DTYPE_F32;       // 16-bit views never start mid-storage
     Tensor grad;
     std::vector<Tensor> _prev;
     std::function<void(const Tensor&)> _backward;
 };
 
+struct LossScale::State
+{
+    float scale;
+    float applied; // scale of the last scale(), which the next step undoes
+    bool dynamic;
+    uint32_t interval;
+    uint32_t clean = 0; // steps since the last overflow or growth
+    Tensor skipped;     // steps skipped on overflow so far, counted on the GPU
+};
+
+void Device_impl::barrier(STAGE after, const std::vector<Tensor>& reads, const std::vector<Tensor>& writes)
+{
+    assert(after < TENSOR_STAGES);
+    auto pending = [&](const uint64_t (&uses)[TENSOR_STAGES])
+    {
+        for (int stage = 0; stage < TENSOR_STAGES; stage++)
+        {
+            if (uses[stage] > synced[stage][after])
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    bool needed = false;
+    for (auto& tensor : reads)
+    {
+        needed = needed || pending(tensor._self->_storage->write_epoch);
+    }
+    for (auto& tensor : writes)
+    {
+        // write after read as well as write after write
+        needed = needed || pending(tensor._self->_storage->write_epoch) || pending(tensor._self->_storage->read_epoch);
+    }
+
+    if (needed)
+    {
+        for (int stage = 0; stage < TENSOR_STAGES; stage++)
+        {
+            if (last_use[stage] > synced[stage][after])
+            {
+                gpuBarrier(cmd, static_cast<STAGE>(stage), after);
+                synced[stage][after] = epoch;
+            }
+        }
+        epoch++;
+    }
+
+    for (auto& tensor : reads)
+    {
+        tensor._self->_storage->read_epoch[after] = epoch;
+    }
+    for (auto& tensor : writes)
+    {
+        tensor._self->_storage->write_epoch[after] = epoch;
+    }
+    last_use[after] = epoch;
+}
+
+void Device_impl::written(STAGE stage, const std::vector<Tensor>& tensors)
+{
+    for (auto& tensor : tensors)
+    {
+        tensor._self->_storage->write_epoch[stage] = epoch;
+    }
+    last_use[stage] = epoch;
+}
+
+// Row-major strides of `shape`, in elements.
+static std::vector<uint64_t> row_major(const Shape& shape)
+{
+    std::vector<uint64_t> strides(shape.size(), 1);
+    for (size_t i = shape.size(); i-- > 1;)
+    {
+        strides[i - 1] = strides[i] * shape[i];
+    }
+    return strides;
+}
+
+// Strides of a view, or none when the view is row-major. Dimensions of size
+// one are skipped, their stride is never used.
+static std::vector<uint64_t> layout(const Shape& shape, std::vector<uint64_t> strides)
+{
+    auto dense = row_major(shape);
+    for (size_t i = 0; i < shape.size(); i++)
+    {
+        if (shape[i] != 1 && strides[i] != dense[i])
+        {
+            return strides;
+        }
+    }
+    return {};
+}
+
 Instance::Instance()
 {
     gpuCreateInstance();
@@ -347,7 +588,6 @@ Instance::Instance()
 
 Instance::~Instance()
 {
-    tensors_pending_writes.clear();
     for (auto device : devices)
     {
         delete device;
@@ -379,7 +619,7 @@ Tensor& Tensor::operator=(Tensor&& other) noexcept
     return *this;
 }
 
-Tensor::Tensor(Device_impl* device, std::vector<float> data, std::vector<Tensor> prev, Shape shape, bool slice)
+Tensor::Tensor(Device_impl* device, std::vector<float> data, std::vector<Tensor> prev, Shape shape)
     : _shape(shape)
 {
     if (_shape.empty())
@@ -396,18 +636,35 @@ Tensor::Tensor(Device_impl* device, std::vector<float> data, std::vector<Tensor>
     _self = std::make_shared<Tensor_impl>();
     _self->_device = device;
     _self->_allocation = _self->_device->floats(data.size());
-    _self->_slice = slice;
+    _self->_storage = std::make_shared<Tensor_storage>(device, _self->_allocation);
     _self->_prev = std::move(prev);
     memcpy(_self->_allocation.cpu, data.data(), data.size() * sizeof(float));
 }
 
-Tensor::Tensor(Device_impl* device, Allocation<float> allocation, std::vector<Tensor> prev, Shape shape, bool slice)
+Tensor::Tensor(Device_impl* device, Allocation<float> allocation, std::vector<Tensor> prev, Shape shape)
     : _shape(shape)
 {
-    _self = std::make_shared<Tensor_impl>(device, allocation, slice);
+    _self = std::make_shared<Tensor_impl>();
+    _self->_device = device;
+    _self->_storage = std::make_shared<Tensor_storage>(device, allocation);
+    _self->_allocation = allocation;
     _self->_prev = std::move(prev);
 }
 
+Tensor Tensor::view(Allocation<float> allocation, Shape shape, std::vector<uint64_t> strides, std::vector<Tensor> prev) const
+{
+    Tensor out;
+    out._shape = std::move(shape);
+    out._self = std::make_shared<Tensor_impl>();
+    out._self->_device = _self->_device;
+    out._self->_storage = _self->_storage;
+    out._self->_allocation = allocation;
+    out._self->_strides = std::move(strides);
+    out._self->_dtype = _self->_dtype;
+    out._self->_prev = std::move(prev);
+    return out;
+}
+
 bool Tensor::null() const
 {
     return _shape.empty();
@@ -428,6 +685,11 @@ uint64_t Tensor::numel() const
     return flatten(_shape);
 }
 
+DTYPE Tensor::dtype() const
+{
+    return _self->_dtype;
+}
+
 Tensor Tensor::grad() const
 {
     return _self->grad;
@@ -462,11 +724,12 @@ std::string to_string(Allocation<float> readback, Shape shape, uint64_t offset =
 
 Tensor::operator std::string() const
 {
+    auto dense = plain();
     auto size = flatten(_shape);
     auto readback = _self->_device->readback(size);
     auto cmd = _self->_device->record();
-    _self->_device->barrier(STAGE_COMPUTE, { *this });
-    gpuMemCpy(cmd, readback.gpu, _self->_allocation.gpu, readback.size);
+    _self->_device->barrier(STAGE_TRANSFER, { dense });
+    gpuMemCpy(cmd, readback.gpu, dense._self->_allocation.gpu, readback.size);
     _self->_device->submit();
     _self->_device->flush();
 
@@ -475,11 +738,12 @@ Tensor::operator std::string() const
 
 std::vector<float> Tensor::cpu()
 {
+    auto dense = plain();
     auto size = flatten(_shape);
     auto readback = _self->_device->readback(size);
     auto cmd = _self->_device->record();
-    _self->_device->barrier(STAGE_COMPUTE, { *this });
-    gpuMemCpy(cmd, readback.gpu, _self->_allocation.gpu, readback.size);
+    _self->_device->barrier(STAGE_TRANSFER, { dense });
+    gpuMemCpy(cmd, readback.gpu, dense._self->_allocation.gpu, readback.size);
     _self->_device->submit();
     _self->_device->flush();
 
@@ -490,11 +754,12 @@ std::vector<float> Tensor::cpu()
 
 void Tensor::cpu(std::function<void(std::vector<float>)> cb)
 {
+    auto dense = plain();
     auto size = flatten(_shape);
     auto readback = _self->_device->readback(size);
     auto cmd = _self->_device->record();
-    _self->_device->barrier(STAGE_COMPUTE, { *this });
-    gpuMemCpy(cmd, readback.gpu, _self->_allocation.gpu, readback.size);
+    _self->_device->barrier(STAGE_TRANSFER, { dense });
+    gpuMemCpy(cmd, readback.gpu, dense._self->_allocation.gpu, readback.size);
 
     _self->_device->cpu_callbacks[_self->_device->frame].push_back(std::make_pair(readback, cb));
 }
@@ -511,6 +776,11 @@ Tensor Tensor::operator+(const Tensor& other) const
         return *this;
     }
 
+    if (!is_plain() || !other.is_plain())
+    {
+        return plain() + other.plain();
+    }
+
     uint broadcast = 1;
     if (_shape != other._shape)
     {
@@ -539,13 +809,13 @@ Tensor Tensor::operator+(const Tensor& other) const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["add"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_ADD]);
     _self->_device->barrier(STAGE_COMPUTE, { *this, other });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this, other }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     Tensor self = *this;
     out._self->_backward = [self, other, broadcast](const Tensor& grad)
@@ -584,6 +854,11 @@ Tensor Tensor::operator-(const Tensor& other) const
         return *this;
     }
 
+    if (!is_plain() || !other.is_plain())
+    {
+        return plain() - other.plain();
+    }
+
     uint broadcast = 1;
     if (_shape != other._shape)
     {
@@ -612,13 +887,13 @@ Tensor Tensor::operator-(const Tensor& other) const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["sub"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_SUB]);
     _self->_device->barrier(STAGE_COMPUTE, { *this, other });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this, other }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     Tensor self = *this;
     out._self->_backward = [self, other, broadcast](const Tensor& grad)
@@ -642,6 +917,11 @@ Tensor Tensor::operator-(const Tensor& other) const
 
 Tensor Tensor::operator*(const Tensor& other) const
 {
+    if (!is_plain() || !other.is_plain())
+    {
+        return plain() * other.plain();
+    }
+
     uint broadcast = 1;
     if (_shape != other._shape)
     {
@@ -670,13 +950,13 @@ Tensor Tensor::operator*(const Tensor& other) const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["mul"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_MUL]);
     _self->_device->barrier(STAGE_COMPUTE, { *this, other });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this, other }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     Tensor self = *this;
     out._self->_backward = [self, other](const Tensor& grad)
@@ -689,6 +969,11 @@ Tensor Tensor::operator*(const Tensor& other) const
 
 Tensor Tensor::operator/(const Tensor& other) const
 {
+    if (!is_plain() || !other.is_plain())
+    {
+        return plain() / other.plain();
+    }
+
     uint broadcast = 1;
     if (_shape != other._shape)
     {
@@ -717,13 +1002,13 @@ Tensor Tensor::operator/(const Tensor& other) const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["div"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_DIV]);
     _self->_device->barrier(STAGE_COMPUTE, { *this, other });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this, other }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     Tensor self = *this;
     out._self->_backward = [self, other, broadcast](const Tensor& grad)
@@ -768,6 +1053,11 @@ Tensor Tensor::operator/(float x) const
 
 Tensor Tensor::operator[](unsigned int i) const
 {
+    if (_self->_dtype != DTYPE_F32)
+    {
+        return plain()[i]; // a 16-bit slice could start mid-word
+    }
+
     Shape res_shape = _shape;
     res_shape.erase(res_shape.begin());
     if (res_shape.empty())
@@ -775,13 +1065,20 @@ Tensor Tensor::operator[](unsigned int i) const
         res_shape = { 1 };
     }
 
-    auto size = flatten(res_shape);
+    auto strides = is_contiguous() ? row_major(_shape) : _self->_strides;
 
     Allocation<float> allocation = _self->_allocation;
-    allocation.cpu += (size * i);
-    allocation.gpu += (size * i);
+    allocation.cpu += strides.front() * i;
+    allocation.gpu += strides.front() * i;
+    allocation.size = flatten(res_shape) * sizeof(float);
 
-    return Tensor(_self->_device, allocation, { *this }, res_shape, true);
+    strides.erase(strides.begin());
+    if (strides.empty())
+    {
+        strides = { 1 };
+    }
+
+    return view(allocation, res_shape, layout(res_shape, strides), { *this });
 }
 
 Tensor Tensor::repeat(const Tensor& tensor, Shape shape) const
@@ -791,123 +1088,430 @@ Tensor Tensor::repeat(const Tensor& tensor, Shape shape) const
 
 Tensor Tensor::mT() const
 {
-    if (_shape.size() != 2)
+    if (_shape.size() < 2)
     {
         auto error = "cannot transpose a tensor that isn't a matrix";
         throw std::runtime_error(error);
     }
 
-    Shape res_shape = { _shape.back(), _shape.front() };
-    auto size = flatten(res_shape);
+    auto strides = is_contiguous() ? row_major(_shape) : _self->_strides;
+    Shape res_shape = _shape;
+    std::swap(res_shape[res_shape.size() - 2], res_shape.back());
+    std::swap(strides[strides.size() - 2], strides.back());
+
+    return view(_self->_allocation, res_shape, layout(res_shape, strides), { *this });
+}
+
+bool Tensor::is_contiguous() const
+{
+    return _self->_strides.empty();
+}
+
+Tensor Tensor::contiguous() const
+{
+    if (is_contiguous())
+    {
+        return *this;
+    }
+
+    // the gather widens 16-bit elements
+    return gather().to(_self->_dtype);
+}
+
+Tensor Tensor::gather() const
+{
+    if (_shape.size() > TENSOR_MAX_DIMS)
+    {
+        auto error = "cannot gather a view of shape " + to_string(_shape) + ", more than " + std::to_string(TENSOR_MAX_DIMS) + " dimensions";
+        throw std::runtime_error(error);
+    }
 
+    auto size = flatten(_shape);
     auto allocation = _self->_device->floats(size);
 
-    auto tensor_data = _self->_device->struct_data<TensorTransposeData>();
+    auto tensor_data = _self->_device->struct_data<TensorLayoutData>();
     tensor_data.cpu->n = size;
-    tensor_data.cpu->r = _shape.front();
-    tensor_data.cpu->c = _shape.back();
+    tensor_data.cpu->rank = static_cast<uint32_t>(_shape.size());
+    for (size_t i = 0; i < _shape.size(); i++)
+    {
+        tensor_data.cpu->shape[i] = _shape[i];
+        tensor_data.cpu->strides[i] = _self->_strides[i];
+    }
+    tensor_data.cpu->dtype = _self->_dtype;
     tensor_data.cpu->x = _self->_allocation.gpu;
     tensor_data.cpu->y = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["mT"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_CONTIGUOUS]);
     _self->_device->barrier(STAGE_COMPUTE, { *this });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
-    auto out = Tensor(_self->_device, allocation, { *this }, res_shape);
+    auto out = Tensor(_self->_device, allocation, { *this }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
+    Tensor self = *this;
+    out._self->_backward = [self](const Tensor& grad)
+    {
+        self._self->grad = (self._self->grad + grad).detach();
+    };
     return out;
 }
 
-Tensor Tensor::dot(const Tensor& other) const
+bool Tensor::is_plain() const
 {
-    if (_shape != other._shape)
+    return is_contiguous() && _self->_dtype == DTYPE_F32;
+}
+
+Tensor Tensor::plain() const
+{
+    return is_contiguous() ? to(DTYPE_F32) : gather();
+}
+
+Tensor Tensor::to(DTYPE dtype) const
+{
+    if (dtype == _self->_dtype)
     {
-        auto error = "cannot compute the dot product of tensor of shape " + to_string(other._shape) + " to tensor of shape " + to_string(_shape);
-        throw std::runtime_error(error);
+        return *this;
+    }
+
+    if (!is_contiguous())
+    {
+        return gather().to(dtype);
     }
 
     auto size = flatten(_shape);
-    auto allocation = _self->_device->floats(1);
-    memset(allocation.cpu, 0, sizeof(float));
+    auto allocation = _self->_device->floats(words(dtype, size));
 
-    auto tensor_data = _self->_device->struct_data<TensorData>();
+    auto tensor_data = _self->_device->struct_data<TensorConvertData>();
     tensor_data.cpu->n = size;
+    tensor_data.cpu->from = _self->_dtype;
+    tensor_data.cpu->to = dtype;
     tensor_data.cpu->x = _self->_allocation.gpu;
-    tensor_data.cpu->y = other._self->_allocation.gpu;
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["dot"]);
-    _self->_device->barrier(STAGE_COMPUTE, { *this, other });
-    gpuDispatch(cmd, tensor_data.gpu, { 1, 1, 1 });
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_CONVERT]);
+    _self->_device->barrier(STAGE_COMPUTE, { *this });
+    gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>((size + 1) / 2 + 63) / 64, 1, 1 });
 
-    auto out = Tensor(_self->_device, allocation, { *this, other }, { 1 });
+    auto out = Tensor(_self->_device, allocation, { *this }, _shape);
+    out._self->_dtype = dtype;
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
+    // grads stay fp32 whatever the dtype
     Tensor self = *this;
-    out._self->_backward = [self, other](const Tensor& grad)
+    out._self->_backward = [self](const Tensor& grad)
     {
-        self._self->grad = (self._self->grad + other * grad).detach();
-        other._self->grad = (other._self->grad + self * grad).detach();
+        self._self->grad = (self._self->grad + grad).detach();
     };
     return out;
 }
 
-Tensor Tensor::matmul(const Tensor& other) const
+// Multi-pass tree reduction: the first pass folds x (or x * y) into at most
+// TENSOR_REDUCE_MAX_GROUPS partials, later passes fold partials until one
+// value is left. scale is applied on the last pass only.
+Tensor Tensor::reduce(uint32_t op, const Tensor& other, float scale) const
 {
-    if (_shape.size() != 2 || other._shape.size() != 2)
+    if (!is_contiguous() || !other.is_contiguous())
     {
-        std::string error = "batched matmul not yet implemented";
-        throw std::runtime_error(error);
+        return contiguous().reduce(op, other.contiguous(), scale);
     }
 
-    // (a,b) mat and (c,d) mat results in (a,d) mat, and b must equal c
-    if (_shape.back() != other._shape.front())
-    {
-        auto error = "cannot matmul tensor of shape " + to_string(other._shape) + " to tensor of shape " + to_string(_shape);
-        throw std::runtime_error(error);
-    }
+    auto n = flatten(_shape);
+    auto x = _self->_allocation.gpu;
+    uint32_t xdtype = _self->_dtype;
+    std::vector<Tensor> inputs = { *this, other };
+    Tensor partial;
 
-    Shape res_shape = { _shape.front(), other._shape.back() };
-    auto size = flatten(res_shape);
+    while (true)
+    {
+        auto groups = std::min<uint64_t>((n + TENSOR_REDUCE_GROUP - 1) / TENSOR_REDUCE_GROUP, TENSOR_REDUCE_MAX_GROUPS);
+        auto allocation = _self->_device->floats(groups);
+
+        auto tensor_data = _self->_device->struct_data<TensorReduceData>();
+        tensor_data.cpu->n = n;
+        tensor_data.cpu->grid = groups * TENSOR_REDUCE_GROUP;
+        tensor_data.cpu->op = op;
+        tensor_data.cpu->scale = groups == 1 ? scale : 1.f;
+        tensor_data.cpu->xdtype = xdtype;
+        tensor_data.cpu->ydtype = other._self->_dtype;
+        tensor_data.cpu->x = x;
+        tensor_data.cpu->y = other._self->_allocation.gpu;
+        tensor_data.cpu->z = allocation.gpu;
 
-    auto allocation = _self->_device->floats(size);
+        auto cmd = _self->_device->record();
+        gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_REDUCE]);
+        _self->_device->barrier(STAGE_COMPUTE, inputs);
+        gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(groups), 1, 1 });
 
-    auto tensor_data = _self->_device->struct_data<TensorMatMulData>();
-    tensor_data.cpu->n = size;
-    tensor_data.cpu->a = _shape.front();
-    tensor_data.cpu->b = _shape.back();
-    tensor_data.cpu->c = other._shape.back();
-    tensor_data.cpu->x = _self->_allocation.gpu;
-    tensor_data.cpu->y = other._self->_allocation.gpu;
-    tensor_data.cpu->z = allocation.gpu;
+        if (groups == 1)
+        {
+            auto out = Tensor(_self->_device, allocation, { *this, other }, { 1 });
+            _self->_device->written(STAGE_COMPUTE, { out });
+            return out;
+        }
 
-    auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["matmul"]);
-    _self->_device->barrier(STAGE_COMPUTE, { *this, other });
-    gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
+        // partials are summed (or maxed) as plain values on the next pass
+        partial = Tensor(_self->_device, allocation, {}, { static_cast<unsigned int>(groups) });
+        _self->_device->written(STAGE_COMPUTE, { partial });
+        inputs = std::vector<Tensor>{ partial };
+        op = op == TENSOR_REDUCE_MAX ? TENSOR_REDUCE_MAX : TENSOR_REDUCE_SUM;
+        x = allocation.gpu;
+        xdtype = DTYPE_F32;
+        n = groups;
+    }
+}
 
-    auto out = Tensor(_self->_device, allocation, { *this, other }, res_shape);
+Tensor Tensor::dot(const Tensor& other) const
+{
+    if (_shape != other._shape)
+    {
+        auto error = "cannot compute the dot product of tensor of shape " + to_string(other._shape) + " to tensor of shape " + to_string(_shape);
+        throw std::runtime_error(error);
+    }
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    auto out = reduce(TENSOR_REDUCE_DOT, other, 1.f);
 
     Tensor self = *this;
     out._self->_backward = [self, other](const Tensor& grad)
     {
-        self._self->grad = (self._self->grad + grad.matmul(other.mT())).detach();
-        other._self->grad = (other._self->grad + self.mT().matmul(grad)).detach();
+        self._self->grad = (self._self->grad + other * grad).detach();
+        other._self->grad = (other._self->grad + self * grad).detach();
     };
     return out;
 }
 
-Tensor Tensor::pow(const Tensor& other) const
+Tensor Tensor::matmul(const Tensor& other) const
 {
-    uint broadcast = 1;
-    if (_shape != other._shape)
+    return matmul(other, false, false);
+}
+
+// Sums a batched gradient over the batch (leading) dimensions an operand was
+// broadcast across, back to the operand's own shape.
+static Tensor reduce_batches(Device_impl* device, const Tensor& grad, const Shape& shape)
+{
+    auto inner = flatten(shape);
+    auto batches = grad.numel() / inner;
+    if (batches == 1)
+    {
+        return grad.reshape(shape);
+    }
+    auto rows = grad.reshape({ static_cast<unsigned int>(batches), static_cast<unsigned int>(inner) });
+    return device->ones({ 1, static_cast<unsigned int>(batches) }).matmul(rows).reshape(shape);
+}
+
+// The row-major tensor an mT() view was taken from, on the same storage, or
+// a null tensor when `tensor` is strided some other way. Its gradient flows
+// back to the view.
+static Tensor transposed_storage(const Tensor& tensor)
+{
+    auto stored = tensor.mT();
+    return stored.is_contiguous() ? stored.detach() : Tensor();
+}
+
+// Operands are matrices in their last two dimensions; leading dimensions are
+// batches. The batch shapes must match, or one side has a single matrix that
+// is broadcast across the other's batch. transpose_self / transpose_other read
+// an operand's matrices as their transposes in place, so backward's grad y^T
+// and x^T grad never materialize an mT(), and neither does a product with an
+// mT() view.
+Tensor Tensor::matmul(const Tensor& other, bool transpose_self, bool transpose_other) const
+{
+    if (_shape.size() < 2 || other._shape.size() < 2)
+    {
+        std::string error = "cannot matmul tensors of shape " + to_string(_shape) + " and " + to_string(other._shape) + ", both need at least 2 dimensions";
+        throw std::runtime_error(error);
+    }
+
+    if (!is_contiguous())
+    {
+        auto stored = transposed_storage(*this);
+        if (stored.null())
+        {
+            return contiguous().matmul(other, transpose_self, transpose_other);
+        }
+        stored._self->_prev = std::vector<Tensor>{ *this };
+        Tensor self = *this;
+        stored._self->_backward = [self](const Tensor& grad)
+        {
+            self._self->grad = (self._self->grad + grad.mT().contiguous()).detach();
+        };
+        return stored.matmul(other, !transpose_self, transpose_other);
+    }
+
+    if (!other.is_contiguous())
+    {
+        auto stored = transposed_storage(other);
+        if (stored.null())
+        {
+            return matmul(other.contiguous(), transpose_self, transpose_other);
+        }
+        stored._self->_prev = std::vector<Tensor>{ other };
+        stored._self->_backward = [other](const Tensor& grad)
+        {
+            other._self->grad = (other._self->grad + grad.mT().contiguous()).detach();
+        };
+        return matmul(stored, transpose_self, !transpose_other);
+    }
+
+    Shape x_batch(_shape.begin(), _shape.end() - 2);
+    Shape y_batch(other._shape.begin(), other._shape.end() - 2);
+    uint64_t x_batches = flatten(x_batch);
+    uint64_t y_batches = flatten(y_batch);
+    if (x_batch != y_batch && x_batches != 1 && y_batches != 1)
+    {
+        auto error = "cannot broadcast matmul batches of tensor of shape " + to_string(other._shape) + " to tensor of shape " + to_string(_shape);
+        throw std::runtime_error(error);
+    }
+    Shape res_batch = x_batches >= y_batches ? x_batch : y_batch;
+    uint64_t batches = std::max(x_batches, y_batches);
+
+    unsigned int x_rows = _shape[_shape.size() - 2];
+    unsigned int x_cols = _shape.back();
+    unsigned int y_rows = other._shape[other._shape.size() - 2];
+    unsigned int y_cols = other._shape.back();
+    if (transpose_self)
+    {
+        std::swap(x_rows, x_cols);
+    }
+    if (transpose_other)
+    {
+        std::swap(y_rows, y_cols);
+    }
+
+    // (a,b) mat and (c,d) mat results in (a,d) mat, and b must equal c
+    if (x_cols != y_rows)
+    {
+        auto error = "cannot matmul tensor of shape " + to_string(other._shape) + " to tensor of shape " + to_string(_shape);
+        throw std::runtime_error(error);
+    }
+
+    Shape res_shape = append(res_batch, { x_rows, y_cols });
+    auto size = flatten(res_shape);
+
+    auto allocation = _self->_device->floats(size);
+
+    auto tensor_data = _self->_device->struct_data<TensorMatMulData>();
+    tensor_data.cpu->n = size;
+    tensor_data.cpu->a = x_rows;
+    tensor_data.cpu->b = x_cols;
+    tensor_data.cpu->c = y_cols;
+    tensor_data.cpu->sx = x_batches == 1 ? 0 : static_cast<uint64_t>(x_rows) * x_cols;
+    tensor_data.cpu->sy = y_batches == 1 ? 0 : static_cast<uint64_t>(y_rows) * y_cols;
+    tensor_data.cpu->tx = transpose_self;
+    tensor_data.cpu->ty = transpose_other;
+    tensor_data.cpu->xdtype = _self->_dtype;
+    tensor_data.cpu->ydtype = other._self->_dtype;
+    tensor_data.cpu->x = _self->_allocation.gpu;
+    tensor_data.cpu->y = other._self->_allocation.gpu;
+    tensor_data.cpu->z = allocation.gpu;
+
+    // Tile by output shape: 64x64 blocks once both sides fill them, 16x16
+    // blocks for narrower outputs, split-k for vectors (GEMV).
+    auto rows = x_rows;
+    auto cols = y_cols;
+    auto outputs = (size + 15) / 16;
+    auto cmd = _self->_device->record();
+    if (_self->_device->naive_matmul || ((rows < 16 || cols < 16) && outputs > 65535))
+    {
+        gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_MATMUL]);
+        _self->_device->barrier(STAGE_COMPUTE, { *this, other });
+        gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
+    }
+    else if (rows < 16 || cols < 16)
+    {
+        // e.g. a batch of one through a wide layer: 256 outputs over 196608
+        // products each fill 16 groups alone, so k is split across groups too
+        auto splits = std::max<uint64_t>(1, std::min<uint64_t>(x_cols / TENSOR_MATMUL_SPLIT_K, TENSOR_MATMUL_SPLIT_GROUPS / outputs));
+        tensor_data.cpu->k = (x_cols + splits - 1) / splits;
+
+        gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_MATMUL_SPLITK]);
+        _self->_device->barrier(STAGE_COMPUTE, { *this, other });
+        if (splits == 1)
+        {
+            gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(outputs), 1, 1 });
+        }
+        else
+        {
+            // one row of partials per slice, summed as a (1, splits) x (splits, size) product
+            auto partial = Tensor(_self->_device, _self->_device->floats(splits * size), {}, { static_cast<unsigned int>(splits), static_cast<unsigned int>(size) });
+            tensor_data.cpu->z = partial._self->_allocation.gpu;
+            gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(outputs), static_cast<unsigned int>(splits), 1 });
+            _self->_device->written(STAGE_COMPUTE, { partial });
+
+            auto ones = _self->_device->ones({ 1, static_cast<unsigned int>(splits) });
+            auto sum_data = _self->_device->struct_data<TensorMatMulData>();
+            *sum_data.cpu = {};
+            sum_data.cpu->n = size;
+            sum_data.cpu->a = 1;
+            sum_data.cpu->b = splits;
+            sum_data.cpu->c = size;
+            sum_data.cpu->k = splits;
+            sum_data.cpu->x = ones._self->_allocation.gpu;
+            sum_data.cpu->y = partial._self->_allocation.gpu;
+            sum_data.cpu->z = allocation.gpu;
+
+            cmd = _self->_device->record();
+            gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_MATMUL_SPLITK]);
+            _self->_device->barrier(STAGE_COMPUTE, { ones, partial });
+            gpuDispatch(cmd, sum_data.gpu, { static_cast<unsigned int>(outputs), 1, 1 });
+        }
+    }
+    else if (rows >= 64 && cols >= 64)
+    {
+        gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_MATMUL_TILE64]);
+        _self->_device->barrier(STAGE_COMPUTE, { *this, other });
+        gpuDispatch(cmd, tensor_data.gpu, { (cols + 63) / 64, (rows + 63) / 64, static_cast<unsigned int>(batches) });
+    }
+    else
+    {
+        gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_MATMUL_TILE16]);
+        _self->_device->barrier(STAGE_COMPUTE, { *this, other });
+        gpuDispatch(cmd, tensor_data.gpu, { (cols + 15) / 16, (rows + 15) / 16, static_cast<unsigned int>(batches) });
+    }
+
+    auto out = Tensor(_self->_device, allocation, { *this, other }, res_shape);
+
+    _self->_device->written(STAGE_COMPUTE, { out });
+
+    Tensor self = *this;
+    out._self->_backward = [self, other, transpose_self, transpose_other](const Tensor& grad)
+    {
+        // z = x y  =>  dx = grad y^T, dy = x^T grad, with x = op(self) and
+        // y = op(other); a stored-transposed operand takes the transposed
+        // gradient (dy^T = grad^T x). Gradients of broadcast operands are
+        // summed over the batches they were broadcast across.
+        auto device = self._self->_device;
+        auto dself = transpose_self ? other.matmul(grad, transpose_other, true) : grad.matmul(other, false, !transpose_other);
+        Tensor dother;
+        if (!transpose_self && !transpose_other && other._shape.size() == 2 && self._shape.size() > 2)
+        {
+            // one weight matrix under a batch: fold the batches into the rows
+            auto k = self._shape.back();
+            auto m = static_cast<unsigned int>(self.numel() / k);
+            dother = self.reshape({ m, k }).matmul(grad.reshape({ m, other._shape.back() }), true, false);
+        }
+        else
+        {
+            dother = transpose_other ? grad.matmul(self, true, transpose_self) : self.matmul(grad, !transpose_self, false);
+        }
+        self._self->grad = (self._self->grad + reduce_batches(device, dself, self._shape)).detach();
+        other._self->grad = (other._self->grad + reduce_batches(device, dother, other._shape)).detach();
+    };
+    return out;
+}
+
+Tensor Tensor::pow(const Tensor& other) const
+{
+    if (!is_plain() || !other.is_plain())
+    {
+        return plain().pow(other.plain());
+    }
+
+    uint broadcast = 1;
+    if (_shape != other._shape)
     {
         if (_shape.back() == other._shape.back() || other._shape == unit)
         {
@@ -934,13 +1538,13 @@ Tensor Tensor::pow(const Tensor& other) const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["pow"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_POW]);
     _self->_device->barrier(STAGE_COMPUTE, { *this, other });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this, other }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     return out;
 }
@@ -953,12 +1557,49 @@ Tensor Tensor::pow(float x) const
 Tensor Tensor::mse(const Tensor& other) const
 {
     auto dif = *this - other;
-    return (dif * dif).sum() / flatten(dif._shape);
+    auto n = static_cast<float>(flatten(dif._shape));
+    auto out = dif.reduce(TENSOR_REDUCE_DOT, dif, 1.f / n);
+    out._self->_prev = std::vector<Tensor>{ dif };
+
+    out._self->_backward = [dif, n](const Tensor& grad)
+    {
+        dif._self->grad = (dif._self->grad + dif * grad * (2.f / n)).detach();
+    };
+    return out;
 }
 
 Tensor Tensor::sum() const
 {
-    return dot(_self->_device->ones(_shape));
+    auto out = reduce(TENSOR_REDUCE_SUM, *this, 1.f);
+    out._self->_prev = std::vector<Tensor>{ *this };
+
+    Tensor self = *this;
+    out._self->_backward = [self](const Tensor& grad)
+    {
+        self._self->grad = (self._self->grad + self._self->_device->ones(self._shape) * grad).detach();
+    };
+    return out;
+}
+
+Tensor Tensor::mean() const
+{
+    auto n = static_cast<float>(flatten(_shape));
+    auto out = reduce(TENSOR_REDUCE_SUM, *this, 1.f / n);
+    out._self->_prev = std::vector<Tensor>{ *this };
+
+    Tensor self = *this;
+    out._self->_backward = [self, n](const Tensor& grad)
+    {
+        self._self->grad = (self._self->grad + self._self->_device->repeat(1.f / n, self._shape) * grad).detach();
+    };
+    return out;
+}
+
+Tensor Tensor::max() const
+{
+    auto out = reduce(TENSOR_REDUCE_MAX, *this, 1.f);
+    out._self->_prev = std::vector<Tensor>{ *this };
+    return out;
 }
 
 Tensor Tensor::sqrt() const
@@ -983,6 +1624,11 @@ Tensor Tensor::expm1() const
 
 Tensor Tensor::log() const
 {
+    if (!is_plain())
+    {
+        return plain().log();
+    }
+
     auto size = flatten(_shape);
     auto allocation = _self->_device->floats(size);
 
@@ -993,13 +1639,13 @@ Tensor Tensor::log() const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["log"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_LOG]);
     _self->_device->barrier(STAGE_COMPUTE, { *this });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     return out;
 }
@@ -1011,6 +1657,11 @@ Tensor Tensor::log1p() const
 
 Tensor Tensor::cosh() const
 {
+    if (!is_plain())
+    {
+        return plain().cosh();
+    }
+
     auto size = flatten(_shape);
     auto allocation = _self->_device->floats(size);
 
@@ -1021,19 +1672,24 @@ Tensor Tensor::cosh() const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["cosh"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_COSH]);
     _self->_device->barrier(STAGE_COMPUTE, { *this });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     return out;
 }
 
 Tensor Tensor::tanh() const
 {
+    if (!is_plain())
+    {
+        return plain().tanh();
+    }
+
     auto size = flatten(_shape);
     auto allocation = _self->_device->floats(size);
 
@@ -1044,13 +1700,13 @@ Tensor Tensor::tanh() const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["tanh"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_TANH]);
     _self->_device->barrier(STAGE_COMPUTE, { *this });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     Tensor self = *this;
     out._self->_backward = [self](const Tensor& grad)
@@ -1067,6 +1723,11 @@ Tensor Tensor::sech() const
 
 Tensor Tensor::relu(float alpha) const
 {
+    if (!is_plain())
+    {
+        return plain().relu(alpha);
+    }
+
     auto size = flatten(_shape);
     auto allocation = _self->_device->floats(size);
 
@@ -1078,13 +1739,13 @@ Tensor Tensor::relu(float alpha) const
     tensor_data.cpu->z = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["relu"]);
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_RELU]);
     _self->_device->barrier(STAGE_COMPUTE, { *this });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert(out);
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     Tensor self = *this;
     out._self->_backward = [self, alpha](const Tensor& grad)
@@ -1099,13 +1760,13 @@ Tensor Tensor::relu(float alpha) const
         tensor_data.cpu->z = allocation.gpu;
 
         auto cmd = self._self->_device->record();
-        gpuSetPipeline(cmd, self._self->_device->pipelines["relu_backward"]);
+        gpuSetPipeline(cmd, self._self->_device->pipelines[KERNEL_RELU_BACKWARD]);
         self._self->_device->barrier(STAGE_COMPUTE, { self, grad });
         gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
         auto term = Tensor(self._self->_device, allocation, {}, self.shape());
 
-        tensors_pending_writes[STAGE_COMPUTE].insert(term);
+        self._self->_device->written(STAGE_COMPUTE, { term });
 
         self._self->grad = (self._self->grad + term).detach();
     };
@@ -1114,11 +1775,586 @@ Tensor Tensor::relu(float alpha) const
 
 Tensor Tensor::gelu() const
 {
-    return *this * 0.5f * (1.f + (::sqrt(2.f / pi) * (*this + (*this * *this * *this) * 0.044715f)).tanh());
+    auto x = expr();
+    return (x * 0.5f * (1.f + (::sqrt(2.f / pi) * (x + x * x * x * 0.044715f)).tanh())).eval();
+}
+
+// Instruction list behind an Expr. Programs are immutable once an Expr holds
+// them: every operator copies its operand's program and appends, so Exprs
+// sharing a prefix never see each other's instructions.
+class ExprProgram
+{
+public:
+    std::vector<TensorInstruction> code;
+    std::vector<bool> variable; // register depends on an input
+    std::vector<Tensor> inputs;
+
+    static bool binary(uint32_t op)
+    {
+        return op >= TENSOR_OP_ADD && op <= TENSOR_OP_POW;
+    }
+
+    // Most instructions backward() appends for `ins`: the adjoint terms
+    // below, each with its constants and the ADD accumulating it.
+    uint32_t adjoint_size(const TensorInstruction& ins) const
+    {
+        uint32_t da = ins.op > TENSOR_OP_CONST && variable[ins.a];
+        uint32_t db = binary(ins.op) && variable[ins.b];
+        switch (ins.op)
+        {
+        case TENSOR_OP_ADD:
+            return da + db;
+        case TENSOR_OP_SUB:
+            return da + 3 * db;
+        case TENSOR_OP_MUL:
+            return 2 * da + 2 * db;
+        case TENSOR_OP_DIV:
+            return 2 * da + 5 * db;
+        case TENSOR_OP_POW:
+            return 6 * da + 4 * db;
+        case TENSOR_OP_EXP:
+        case TENSOR_OP_LOG:
+            return 2;
+        case TENSOR_OP_COSH:
+        case TENSOR_OP_SINH:
+        case TENSOR_OP_RELU:
+            return 3;
+        case TENSOR_OP_TANH:
+            return 5;
+        default:
+            return 0;
+        }
+    }
+
+    // Whether the program and its backward (a replay of it, a load of the
+    // gradient and the adjoints) both fit in one _eval dispatch. Exprs split
+    // into separate dispatches before they outgrow this.
+    bool fits() const
+    {
+        size_t size = code.size() + 1;
+        for (auto& ins : code)
+        {
+            size += adjoint_size(ins);
+        }
+        return size <= TENSOR_PROGRAM_MAX_CODE && inputs.size() < TENSOR_PROGRAM_MAX_INPUTS;
+    }
+
+    uint32_t emit(uint32_t op, uint32_t a = 0, uint32_t b = 0, float imm = 0.f)
+    {
+        for (size_t i = 0; op == TENSOR_OP_CONST && i < code.size(); i++)
+        {
+            if (code[i].op == TENSOR_OP_CONST && code[i].imm == imm)
+            {
+                return static_cast<uint32_t>(i);
+            }
+        }
+
+        bool depends = op == TENSOR_OP_LOAD || (op != TENSOR_OP_CONST && (variable[a] || (binary(op) && variable[b])));
+        code.push_back({ op, a, b, imm });
+        variable.push_back(depends);
+        return static_cast<uint32_t>(code.size() - 1);
+    }
+
+    uint32_t constant(float imm)
+    {
+        return emit(TENSOR_OP_CONST, 0, 0, imm);
+    }
+
+    uint32_t load(const Tensor& tensor)
+    {
+        auto dense = tensor.plain();
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            if (inputs[i]._self == dense._self)
+            {
+                return reg(static_cast<uint32_t>(i));
+            }
+        }
+        inputs.push_back(dense);
+        return emit(TENSOR_OP_LOAD, static_cast<uint32_t>(inputs.size() - 1));
+    }
+
+    // register loading input `index`, or ~0u if nothing reads it
+    uint32_t reg(uint32_t index) const
+    {
+        for (size_t i = 0; i < code.size(); i++)
+        {
+            if (code[i].op == TENSOR_OP_LOAD && code[i].a == index)
+            {
+                return static_cast<uint32_t>(i);
+            }
+        }
+        return ~0u;
+    }
+
+    // appends other's instructions, returns the register each of them moved to
+    std::vector<uint32_t> merge(const ExprProgram& other)
+    {
+        std::vector<uint32_t> moved;
+        for (auto& ins : other.code)
+        {
+            switch (ins.op)
+            {
+            case TENSOR_OP_LOAD:
+                moved.push_back(load(other.inputs[ins.a]));
+                break;
+            case TENSOR_OP_CONST:
+                moved.push_back(constant(ins.imm));
+                break;
+            default:
+                moved.push_back(emit(ins.op, moved[ins.a], binary(ins.op) ? moved[ins.b] : 0, ins.imm));
+                break;
+            }
+        }
+        return moved;
+    }
+
+    // Copies the first `count` instructions to `out` with registers assigned:
+    // instruction i writes reg[i], which is reused once the last instruction
+    // reading it has run. Results stay live to the end. Returns the number of
+    // registers used.
+    uint32_t allocate(uint32_t count, const std::vector<uint32_t>& results, TensorInstruction* out, std::vector<uint32_t>& reg) const
+    {
+        std::vector<uint32_t> last(count, 0);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (code[i].op > TENSOR_OP_CONST)
+            {
+                last[code[i].a] = i;
+            }
+            if (binary(code[i].op))
+            {
+                last[code[i].b] = i;
+            }
+        }
+        for (auto result : results)
+        {
+            last[result] = count;
+        }
+
+        std::vector<uint32_t> free;
+        uint32_t registers = 0;
+        reg.assign(count, 0);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            auto ins = code[i];
+            if (ins.op > TENSOR_OP_CONST)
+            {
+                ins.a = reg[code[i].a];
+                ins.b = binary(ins.op) ? reg[code[i].b] : 0;
+
+                // operands read for the last time here can take the result
+                if (last[code[i].a] == i)
+                {
+                    free.push_back(ins.a);
+                }
+                if (binary(ins.op) && last[code[i].b] == i && code[i].b != code[i].a)
+                {
+                    free.push_back(ins.b);
+                }
+            }
+
+            if (free.empty())
+            {
+                free.push_back(registers++);
+            }
+            auto lowest = std::min_element(free.begin(), free.end());
+            ins.dst = reg[i] = *lowest;
+            free.erase(lowest);
+            if (last[i] <= i)
+            {
+                free.push_back(ins.dst); // never read
+            }
+            out[i] = ins;
+        }
+        return registers;
+    }
+
+    // Runs the first `count` instructions over every element of `shape`,
+    // writing each of `results` to a new tensor of that shape.
+    std::vector<Tensor> dispatch(uint32_t count, Shape shape, const std::vector<uint32_t>& results, const std::vector<Tensor>& prev) const
+    {
+        if (count > TENSOR_PROGRAM_MAX_CODE || inputs.size() > TENSOR_PROGRAM_MAX_INPUTS || results.size() > TENSOR_PROGRAM_MAX_OUTPUTS)
+        {
+            throw std::runtime_error("element-wise expression of " + std::to_string(count) + " instructions and " + std::to_string(inputs.size()) + " inputs is too large to fuse");
+        }
+
+        auto device = inputs.front()._self->_device;
+        auto size = flatten(shape);
+
+        auto tensor_data = device->struct_data<TensorProgramData>();
+        tensor_data.cpu->n = size;
+        tensor_data.cpu->count = count;
+        tensor_data.cpu->outputs = static_cast<uint32_t>(results.size());
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            tensor_data.cpu->m[i] = flatten(inputs[i]._shape);
+            tensor_data.cpu->inputs[i] = inputs[i]._self->_allocation.gpu;
+        }
+        std::vector<uint32_t> reg;
+        auto registers = allocate(count, results, tensor_data.cpu->code, reg);
+
+        std::vector<Tensor> outputs;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            auto allocation = device->floats(size);
+            tensor_data.cpu->z[i] = allocation.gpu;
+            tensor_data.cpu->results[i] = reg[results[i]];
+            outputs.push_back(Tensor(device, allocation, prev, shape));
+        }
+
+        auto kernel = registers <= 8 ? KERNEL_EVAL8 : registers <= 32 ? KERNEL_EVAL32 : KERNEL_EVAL;
+        auto cmd = device->record();
+        gpuSetPipeline(cmd, device->pipelines[kernel]);
+        device->barrier(STAGE_COMPUTE, inputs);
+        gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
+
+        for (auto& output : outputs)
+        {
+            device->written(STAGE_COMPUTE, { output });
+        }
+        return outputs;
+    }
+
+    // shape of the result: the largest input, which every other input
+    // broadcasts to
+    Shape shape() const
+    {
+        Shape shape = inputs.front()._shape;
+        for (auto& input : inputs)
+        {
+            if (flatten(input._shape) > flatten(shape))
+            {
+                shape = input._shape;
+            }
+        }
+        for (auto& input : inputs)
+        {
+            bool trailing = input._shape.back() == shape.back() || input._shape == Shape{ 1 };
+            if (!trailing || input._shape.size() > shape.size() || flatten(shape) % flatten(input._shape) != 0)
+            {
+                throw std::runtime_error("cannot broadcast tensor of shape " + to_string(input._shape) + " to tensor of shape " + to_string(shape));
+            }
+        }
+        return shape;
+    }
+
+    Tensor run(uint32_t result) const
+    {
+        auto shape = this->shape();
+        auto out = dispatch(result + 1, shape, { result }, inputs).front();
+
+        auto forward = std::make_shared<const ExprProgram>(*this);
+        out._self->_backward = [forward, result, shape](const Tensor& grad)
+        {
+            forward->backward(result, shape, grad);
+        };
+        return out;
+    }
+
+    // Reverse-mode differentiation of the program: replays the forward
+    // instructions, then appends the adjoint of every register that depends
+    // on an input, from the result back to the loads. One dispatch writes the
+    // gradient of every input.
+    void backward(uint32_t result, const Shape& shape, const Tensor& grad) const
+    {
+        ExprProgram program = *this;
+        program.code.resize(result + 1);
+        program.variable.resize(result + 1);
+
+        std::vector<int64_t> adjoint(result + 1, -1);
+        adjoint[result] = program.load(grad);
+
+        auto accumulate = [&](uint32_t reg, uint32_t value)
+        {
+            adjoint[reg] = adjoint[reg] < 0 ? value : program.emit(TENSOR_OP_ADD, static_cast<uint32_t>(adjoint[reg]), value);
+        };
+
+        for (int64_t i = result; i >= 0; i--)
+        {
+            if (adjoint[i] < 0)
+            {
+                continue;
+            }
+            auto ins = program.code[i];
+            auto g = static_cast<uint32_t>(adjoint[i]);
+            auto r = static_cast<uint32_t>(i);
+            bool da = ins.op > TENSOR_OP_CONST && program.variable[ins.a];
+            bool db = binary(ins.op) && program.variable[ins.b];
+
+            switch (ins.op)
+            {
+            case TENSOR_OP_ADD:
+                if (da)
+                {
+                    accumulate(ins.a, g);
+                }
+                if (db)
+                {
+                    accumulate(ins.b, g);
+                }
+                break;
+            case TENSOR_OP_SUB:
+                if (da)
+                {
+                    accumulate(ins.a, g);
+                }
+                if (db)
+                {
+                    accumulate(ins.b, program.emit(TENSOR_OP_MUL, g, program.constant(-1.f)));
+                }
+                break;
+            case TENSOR_OP_MUL:
+                if (da)
+                {
+                    accumulate(ins.a, program.emit(TENSOR_OP_MUL, g, ins.b));
+                }
+                if (db)
+                {
+                    accumulate(ins.b, program.emit(TENSOR_OP_MUL, g, ins.a));
+                }
+                break;
+            case TENSOR_OP_DIV:
+                // d(a/b)/db = -(a/b)/b
+                if (da)
+                {
+                    accumulate(ins.a, program.emit(TENSOR_OP_DIV, g, ins.b));
+                }
+                if (db)
+                {
+                    accumulate(ins.b, program.emit(TENSOR_OP_MUL, program.emit(TENSOR_OP_DIV, program.emit(TENSOR_OP_MUL, g, r), ins.b), program.constant(-1.f)));
+                }
+                break;
+            case TENSOR_OP_POW:
+                // d(a^b)/da = b a^(b-1), d(a^b)/db = a^b log(a)
+                if (da)
+                {
+                    auto power = program.emit(TENSOR_OP_POW, ins.a, program.emit(TENSOR_OP_SUB, ins.b, program.constant(1.f)));
+                    accumulate(ins.a, program.emit(TENSOR_OP_MUL, g, program.emit(TENSOR_OP_MUL, ins.b, power)));
+                }
+                if (db)
+                {
+                    accumulate(ins.b, program.emit(TENSOR_OP_MUL, g, program.emit(TENSOR_OP_MUL, r, program.emit(TENSOR_OP_LOG, ins.a))));
+                }
+                break;
+            case TENSOR_OP_EXP:
+                accumulate(ins.a, program.emit(TENSOR_OP_MUL, g, r));
+                break;
+            case TENSOR_OP_LOG:
+                accumulate(ins.a, program.emit(TENSOR_OP_DIV, g, ins.a));
+                break;
+            case TENSOR_OP_TANH:
+                accumulate(ins.a, program.emit(TENSOR_OP_MUL, g, program.emit(TENSOR_OP_SUB, program.constant(1.f), program.emit(TENSOR_OP_MUL, r, r))));
+                break;
+            case TENSOR_OP_COSH:
+                accumulate(ins.a, program.emit(TENSOR_OP_MUL, g, program.emit(TENSOR_OP_SINH, ins.a)));
+                break;
+            case TENSOR_OP_SINH:
+                accumulate(ins.a, program.emit(TENSOR_OP_MUL, g, program.emit(TENSOR_OP_COSH, ins.a)));
+                break;
+            case TENSOR_OP_RELU:
+                accumulate(ins.a, program.emit(TENSOR_OP_MUL, g, program.emit(TENSOR_OP_STEP, ins.a, 0, ins.imm)));
+                break;
+            default: // loads, constants and steps have nothing to propagate
+                break;
+            }
+        }
+
+        std::vector<uint32_t> results;
+        std::vector<size_t> targets;
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            auto reg = this->reg(static_cast<uint32_t>(i));
+            if (reg != ~0u && reg <= result && adjoint[reg] >= 0)
+            {
+                results.push_back(static_cast<uint32_t>(adjoint[reg]));
+                targets.push_back(i);
+            }
+        }
+        if (results.empty())
+        {
+            return;
+        }
+
+        auto grads = program.dispatch(static_cast<uint32_t>(program.code.size()), shape, results, {});
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            auto& input = inputs[targets[i]];
+            auto term = reduce_batches(input._self->_device, grads[i], input._shape);
+            input._self->grad = (input._self->grad + term).detach();
+        }
+    }
+};
+
+// Copies of tensor laid end to end, one _eval dispatch whose load wraps
+// around: out[t] = tensor[t % numel(tensor)].
+Tensor Device_impl::repeat(const Tensor& tensor, Shape shape)
+{
+    ExprProgram program;
+    auto reg = program.load(tensor);
+    return program.dispatch(1, append(tensor._shape, shape), { reg }, {}).front();
+}
+
+Expr Tensor::expr() const
+{
+    auto program = std::make_shared<ExprProgram>();
+    auto reg = program->load(*this);
+    return Expr(program, reg);
+}
+
+Expr::Expr(std::shared_ptr<const ExprProgram> program, uint32_t reg)
+    : _program(std::move(program)), _reg(reg)
+{
+}
+
+Tensor Expr::eval() const
+{
+    return _program->run(_reg);
+}
+
+Expr Expr::binary(uint32_t op, const Expr& other) const
+{
+    auto program = std::make_shared<ExprProgram>(*_program);
+    auto b = other._reg;
+    if (other._program != _program)
+    {
+        b = program->merge(*other._program)[other._reg];
+    }
+
+    auto reg = program->emit(op, _reg, b);
+    if (!program->fits())
+    {
+        // too long to fuse with its backward, split here
+        return eval().expr().binary(op, other.eval().expr());
+    }
+    return Expr(program, reg);
+}
+
+Expr Expr::binary(uint32_t op, float x, bool reversed) const
+{
+    auto program = std::make_shared<ExprProgram>(*_program);
+    auto c = program->constant(x);
+    auto reg = reversed ? program->emit(op, c, _reg) : program->emit(op, _reg, c);
+    if (!program->fits())
+    {
+        return eval().expr().binary(op, x, reversed);
+    }
+    return Expr(program, reg);
+}
+
+Expr Expr::unary(uint32_t op, float imm) const
+{
+    auto program = std::make_shared<ExprProgram>(*_program);
+    auto reg = program->emit(op, _reg, 0, imm);
+    if (!program->fits())
+    {
+        return eval().expr().unary(op, imm);
+    }
+    return Expr(program, reg);
+}
+
+Expr Expr::operator-() const
+{
+    return binary(TENSOR_OP_MUL, -1.f);
+}
+
+Expr Expr::operator+(const Expr& other) const
+{
+    return binary(TENSOR_OP_ADD, other);
+}
+
+Expr Expr::operator-(const Expr& other) const
+{
+    return binary(TENSOR_OP_SUB, other);
+}
+
+Expr Expr::operator*(const Expr& other) const
+{
+    return binary(TENSOR_OP_MUL, other);
+}
+
+Expr Expr::operator/(const Expr& other) const
+{
+    return binary(TENSOR_OP_DIV, other);
+}
+
+Expr Expr::operator+(float x) const
+{
+    return binary(TENSOR_OP_ADD, x);
+}
+
+Expr Expr::operator-(float x) const
+{
+    return binary(TENSOR_OP_SUB, x);
+}
+
+Expr Expr::operator*(float x) const
+{
+    return binary(TENSOR_OP_MUL, x);
+}
+
+Expr Expr::operator/(float x) const
+{
+    return binary(TENSOR_OP_DIV, x);
+}
+
+Expr operator-(float x, const Expr& e)
+{
+    return e.binary(TENSOR_OP_SUB, x, true);
+}
+
+Expr operator/(float x, const Expr& e)
+{
+    return e.binary(TENSOR_OP_DIV, x, true);
+}
+
+Expr Expr::pow(const Expr& other) const
+{
+    return binary(TENSOR_OP_POW, other);
+}
+
+Expr Expr::pow(float x) const
+{
+    return binary(TENSOR_OP_POW, x);
+}
+
+Expr Expr::exp() const
+{
+    return unary(TENSOR_OP_EXP);
+}
+
+Expr Expr::log() const
+{
+    return unary(TENSOR_OP_LOG);
+}
+
+Expr Expr::tanh() const
+{
+    return unary(TENSOR_OP_TANH);
+}
+
+Expr Expr::cosh() const
+{
+    return unary(TENSOR_OP_COSH);
+}
+
+Expr Expr::sinh() const
+{
+    return unary(TENSOR_OP_SINH);
+}
+
+Expr Expr::relu(float alpha) const
+{
+    return unary(TENSOR_OP_RELU, alpha);
 }
 
 Tensor Tensor::adam(Tensor& mean, Tensor& variance, uint64_t steps, float b1, float b2)
 {
+    if (!is_plain())
+    {
+        return plain().adam(mean, variance, steps, b1, b2);
+    }
+
     auto size = flatten(_shape);
     auto allocation = _self->_device->floats(size);
 
@@ -1134,55 +2370,174 @@ Tensor Tensor::adam(Tensor& mean, Tensor& variance, uint64_t steps, float b1, fl
     tensor_data.cpu->adjustment = allocation.gpu;
 
     auto cmd = _self->_device->record();
-    gpuSetPipeline(cmd, _self->_device->pipelines["adam"]);
-    _self->_device->barrier(STAGE_COMPUTE, { *this, mean, variance });
+    gpuSetPipeline(cmd, _self->_device->pipelines[KERNEL_ADAM]);
+    _self->_device->barrier(STAGE_COMPUTE, { *this, mean, variance }, { mean, variance });
     gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
 
     auto out = Tensor(_self->_device, allocation, { *this, mean, variance }, _shape);
 
-    tensors_pending_writes[STAGE_COMPUTE].insert({ mean, variance, out });
+    _self->_device->written(STAGE_COMPUTE, { out });
 
     return out;
 }
 
-Tensor Tensor::reshape(Shape shape) const
+void Tensor::sgd(const std::vector<Tensor>& parameters, float lr, const LossScale& loss_scale)
 {
-    if (flatten(_shape) != flatten(shape))
+    step(TENSOR_STEP_SGD, parameters, {}, {}, 0, lr, 0.f, 0.f, loss_scale);
+}
+
+void Tensor::adam(const std::vector<Tensor>& parameters, const std::vector<Tensor>& mean, const std::vector<Tensor>& variance, uint64_t steps, float lr, float b1, float b2,
+                  const LossScale& loss_scale)
+{
+    step(TENSOR_STEP_ADAM, parameters, mean, variance, steps, lr, b1, b2, loss_scale);
+}
+
+// One _step dispatch for all parameters. The entry table is rebuilt every
+// step because each backward pass leaves fresh grad tensors.
+void Tensor::step(uint32_t method, const std::vector<Tensor>& parameters, const std::vector<Tensor>& mean, const std::vector<Tensor>& variance,
+                  uint64_t steps, float lr, float b1, float b2, const LossScale& loss_scale)
+{
+    bool adam = method == TENSOR_STEP_ADAM;
+    std::vector<TensorStepEntry> entries;
+    std::vector<Tensor> reads;
+    std::vector<Tensor> writes;
+    uint64_t size = 0;
+    for (size_t i = 0; i < parameters.size(); i++)
     {
-        auto error = "cannot reshape tensor of shape " + to_string(_shape) + " into shape " + to_string(shape);
-        throw std::runtime_error(error);
+        auto& weights = parameters[i];
+        auto grad = weights._self->grad;
+        if (grad.null())
+        {
+            continue; // not reached by the last backward pass
+        }
+        grad = grad.plain();
+
+        if (!weights.is_contiguous() || (adam && (!mean[i].is_contiguous() || !variance[i].is_contiguous())))
+        {
+            auto error = "cannot update a strided view of shape " + to_string(weights._shape) + " in place";
+            throw std::runtime_error(error);
+        }
+
+        if (!weights.is_plain() || (adam && (!mean[i].is_plain() || !variance[i].is_plain())))
+        {
+            auto error = "cannot update a 16-bit tensor of shape " + to_string(weights._shape) + ", keep the parameters in fp32 and train a copy made with to()";
+            throw std::runtime_error(error);
+        }
+
+        TensorStepEntry entry = {};
+        entry.offset = size;
+        entry.n = flatten(weights._shape);
+        entry.weights = weights._self->_allocation.gpu;
+        entry.grad = grad._self->_allocation.gpu;
+        reads.push_back(grad);
+        writes.push_back(weights);
+        if (adam)
+        {
+            entry.mean = mean[i]._self->_allocation.gpu;
+            entry.variance = variance[i]._self->_allocation.gpu;
+            writes.push_back(mean[i]);
+            writes.push_back(variance[i]);
+        }
+        entries.push_back(entry);
+        size += entry.n;
     }
 
-    auto size = flatten(_shape);
-    auto byte_size = size * sizeof(float);
-    auto allocation = _self->_device->floats(size);
+    if (entries.empty())
+    {
+        return;
+    }
 
-    auto cmd = _self->_device->record();
-    _self->_device->barrier(STAGE_TRANSFER, { *this });
-    gpuMemCpy(cmd, allocation.gpu, _self->_allocation.gpu, byte_size);
+    auto device = parameters.front()._self->_device;
+    auto& scale = *loss_scale._state;
+    auto overflow = scale.dynamic ? device->zeros({ 1 }) : Tensor();
+    if (scale.dynamic && scale.skipped.null())
+    {
+        scale.skipped = device->zeros({ 1 });
+    }
 
-    auto out = Tensor(_self->_device, allocation, { *this }, shape);
+    auto table = device->struct_data<TensorStepEntry>(entries.size());
+    memcpy(table.cpu, entries.data(), entries.size() * sizeof(TensorStepEntry));
 
-    tensors_pending_writes[STAGE_TRANSFER].insert(out);
+    auto tensor_data = device->struct_data<TensorStepData>();
+    tensor_data.cpu->n = size;
+    tensor_data.cpu->entries = static_cast<uint32_t>(entries.size());
+    tensor_data.cpu->method = method;
+    tensor_data.cpu->step = static_cast<uint32_t>(steps);
+    tensor_data.cpu->lr = lr;
+    tensor_data.cpu->b1 = b1;
+    tensor_data.cpu->b2 = b2;
+    tensor_data.cpu->scale = 1.f / scale.applied;
+    tensor_data.cpu->table = table.gpu;
+    tensor_data.cpu->overflow = overflow.null() ? nullptr : overflow._self->_allocation.gpu;
+    tensor_data.cpu->skipped = overflow.null() ? nullptr : scale.skipped._self->_allocation.gpu;
 
-    return out;
+    auto cmd = device->record();
+    if (scale.dynamic)
+    {
+        gpuSetPipeline(cmd, device->pipelines[KERNEL_STEP_CHECK]);
+        device->barrier(STAGE_COMPUTE, reads, { overflow });
+        gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
+        reads.push_back(overflow);
+        writes.push_back(scale.skipped);
+    }
+
+    gpuSetPipeline(cmd, device->pipelines[KERNEL_STEP]);
+    device->barrier(STAGE_COMPUTE, reads, writes);
+    gpuDispatch(cmd, tensor_data.gpu, { static_cast<unsigned int>(size + 63) / 64, 1, 1 });
+
+    if (scale.dynamic)
+    {
+        overflow.cpu([state = loss_scale._state](std::vector<float> flag)
+        {
+            if (flag.front() != 0.f)
+            {
+                state->scale *= 0.5f;
+                state->clean = 0;
+            }
+            else if (++state->clean >= state->interval)
+            {
+                state->scale *= 2.f;
+                state->clean = 0;
+            }
+        });
+    }
 }
 
-Tensor Tensor::detach() const
+LossScale::LossScale(float scale, bool dynamic, uint32_t interval)
+    : _state(std::make_shared<State>(State{ scale, scale, dynamic, interval }))
 {
-    auto size = flatten(_shape);
-    auto byte_size = size * sizeof(float);
-    auto allocation = _self->_device->floats(size);
+}
 
-    auto cmd = _self->_device->record();
-    _self->_device->barrier(STAGE_TRANSFER, { *this });
-    gpuMemCpy(cmd, allocation.gpu, _self->_allocation.gpu, byte_size);
+Tensor LossScale::scale(const Tensor& loss) const
+{
+    _state->applied = _state->scale;
+    return _state->applied == 1.f ? loss : loss * _state->applied;
+}
 
-    auto out = Tensor(_self->_device, allocation, {}, _shape);
+float LossScale::value() const
+{
+    return _state->scale;
+}
 
-    tensors_pending_writes[STAGE_TRANSFER].insert(out);
+Tensor Tensor::reshape(Shape shape) const
+{
+    if (flatten(_shape) != flatten(shape))
+    {
+        auto error = "cannot reshape tensor of shape " + to_string(_shape) + " into shape " + to_string(shape);
+        throw std::runtime_error(error);
+    }
 
-    return out;
+    if (!is_contiguous())
+    {
+        return contiguous().reshape(shape);
+    }
+
+    return view(_self->_allocation, shape, {}, { *this });
+}
+
+Tensor Tensor::detach() const
+{
+    return view(_self->_allocation, _shape, _self->_strides, {});
 }
 
 void Tensor::copy(const Tensor& other) const
@@ -1193,14 +2548,19 @@ void Tensor::copy(const Tensor& other) const
         throw std::runtime_error(error);
     }
 
+    if (!is_contiguous())
+    {
+        auto error = "cannot copy into a strided view of shape " + to_string(_shape);
+        throw std::runtime_error(error);
+    }
+
+    auto src = other.contiguous().to(_self->_dtype);
     auto size = flatten(_shape);
-    auto byte_size = size * sizeof(float);
+    auto byte_size = words(_self->_dtype, size) * sizeof(float);
 
     auto cmd = _self->_device->record();
-    _self->_device->barrier(STAGE_TRANSFER, { other });
-    gpuMemCpy(cmd, _self->_allocation.gpu, other._self->_allocation.gpu, byte_size);
-
-    tensors_pending_writes[STAGE_TRANSFER].insert(*this);
+    _self->_device->barrier(STAGE_TRANSFER, { src }, { *this });
+    gpuMemCpy(cmd, _self->_allocation.gpu, src._self->_allocation.gpu, byte_size);
 }
 
 void Tensor::build(Tensor tensor, std::set<Tensor>& visited, std::vector<Tensor>& graph)
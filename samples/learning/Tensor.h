@@ -11,13 +11,50 @@
 
 using Shape = std::vector<unsigned int>;
 
+// Element types. matmul and the reductions read 16-bit tensors directly and
+// accumulate in fp32; every other op converts its 16-bit inputs to fp32
+// first. Results and gradients are fp32.
+enum DTYPE
+{
+    DTYPE_F32,
+    DTYPE_F16,
+    DTYPE_BF16,
+};
+
+class Tensor;
 class Tensor_impl;
 class Device_impl;
 class Device;
+class Expr;
+class ExprProgram;
 
 template <typename T>
 class Allocation;
 
+// Loss scaling for reduced-precision training: backward from scale(loss) and
+// the optimizer step divides the grads by the same factor. Grads are always
+// fp32 here (16-bit operands are widened before any arithmetic and to()
+// passes its grad back unconverted), so the scale does not keep them from
+// flushing to zero; what a dynamic scale adds is the overflow guard. The step
+// checks the grads on the GPU and skips a step whose grads aren't finite,
+// leaving the weights, Adam's moments and its bias-correction step count as
+// they were. The scale then halves, and it doubles after `interval` steps
+// without overflow. The checks are read back asynchronously, so the scale
+// follows the GPU a couple of steps behind. Copies share their state.
+class LossScale
+{
+public:
+    LossScale(float scale = 1.f, bool dynamic = false, uint32_t interval = 2000);
+
+    Tensor scale(const Tensor& loss) const; // loss * value()
+    float value() const;
+
+private:
+    friend class Tensor;
+    struct State; // holds a Tensor, so defined with Tensor_impl
+    std::shared_ptr<State> _state;
+};
+
 class Tensor
 {
 public:
@@ -38,10 +75,16 @@ public:
 
     Shape shape() const;
     uint64_t numel() const;
+    DTYPE dtype() const;
+
+    Tensor to(DTYPE) const; // convert, this when already of that type
 
     Tensor grad() const;
-    Tensor reshape(Shape) const;
-    Tensor detach() const; // create a clone detached from the graph
+    Tensor reshape(Shape) const; // view when contiguous, copies otherwise
+    Tensor detach() const;       // view detached from the graph, shares storage
+
+    bool is_contiguous() const; // row-major without gaps
+    Tensor contiguous() const;  // this when contiguous, a row-major copy otherwise
 
     Tensor repeat(const Tensor&, Shape) const;
     void copy(const Tensor&) const; // copy from
@@ -59,17 +102,19 @@ public:
     Tensor operator*(float) const; // scalar multiplication
     Tensor operator/(float) const; // scalar division
 
-    Tensor operator[](unsigned int) const; // take a slice of a tensor
+    Tensor operator[](unsigned int) const; // take a slice of a tensor (view)
 
-    Tensor mT() const;                  // 2D matrix transpose, +3D batched matrix transpose
+    Tensor mT() const;                  // 2D matrix transpose, +3D batched matrix transpose (view)
     Tensor dot(const Tensor&) const;    // 1D dot product
-    Tensor matmul(const Tensor&) const; // 2D matrix multiplication, +3D batched matrix multiplcation
+    Tensor matmul(const Tensor&) const; // 2D matrix multiplication, +3D batched (and batch-broadcast) matrix multiplication
 
     Tensor pow(const Tensor&) const;
     Tensor pow(float) const;
 
     Tensor mse(const Tensor&) const;
-    Tensor sum() const;
+    Tensor sum() const;  // full reduction to shape (1)
+    Tensor mean() const; // full reduction to shape (1)
+    Tensor max() const;  // full reduction to shape (1), no gradient
     Tensor sqrt() const;
     Tensor rcp() const;
     Tensor exp() const;
@@ -82,9 +127,20 @@ public:
     Tensor relu(float = 0.f) const;
     Tensor gelu() const;
 
+    Expr expr() const; // start a fused element-wise expression, see Expr
+
     // usage: weights = (weights - lr * grad.adam(mean, variance, step));
     Tensor adam(Tensor& mean, Tensor& variance, uint64_t steps, float b1 = 0.9, float b2 = 0.999);
 
+    // Fused optimizer steps: update every parameter from its grad (and Adam's
+    // mean and variance) in place with a single dispatch. Parameters without
+    // a grad are left alone. Parameters are fp32; train a 16-bit copy made
+    // with to() and its grads flow back to them. steps counts calls; those a
+    // dynamic LossScale skipped are taken off on the GPU.
+    static void sgd(const std::vector<Tensor>& parameters, float lr, const LossScale& = {});
+    static void adam(const std::vector<Tensor>& parameters, const std::vector<Tensor>& mean, const std::vector<Tensor>& variance, uint64_t steps, float lr, float b1 = 0.9, float b2 = 0.999,
+                     const LossScale& = {});
+
     bool operator==(const Tensor& other) const
     {
         return _self < other._self;
@@ -101,10 +157,19 @@ private:
     const Shape unit = { 1 };
     Shape _shape;
     friend class Device_impl;
-    explicit Tensor(Device_impl*, std::vector<float>, std::vector<Tensor> prev, Shape = {}, bool slice = false);
-    explicit Tensor(Device_impl*, Allocation<float>, std::vector<Tensor> prev, Shape = {}, bool slice = false);
+    friend class ExprProgram;
+    explicit Tensor(Device_impl*, std::vector<float>, std::vector<Tensor> prev, Shape = {});
+    explicit Tensor(Device_impl*, Allocation<float>, std::vector<Tensor> prev, Shape = {});
     std::shared_ptr<Tensor_impl> _self;
+    Tensor view(Allocation<float>, Shape, std::vector<uint64_t> strides, std::vector<Tensor> prev) const;
+    Tensor gather() const; // a row-major fp32 copy of a view, whatever its dtype
     static void build(Tensor, std::set<Tensor>&, std::vector<Tensor>&);
+    Tensor reduce(uint32_t op, const Tensor& other, float scale) const; // TENSOR_REDUCE_*
+    Tensor matmul(const Tensor&, bool transpose_self, bool transpose_other) const;
+    bool is_plain() const; // contiguous fp32, what the element-wise kernels read
+    Tensor plain() const;  // this when plain, a contiguous fp32 copy otherwise
+    static void step(uint32_t method, const std::vector<Tensor>& parameters, const std::vector<Tensor>& mean, const std::vector<Tensor>& variance,
+                     uint64_t steps, float lr, float b1, float b2, const LossScale&); // TENSOR_STEP_*
 };
 
 inline Tensor operator+(float x, Tensor t)
@@ -132,6 +197,63 @@ inline Tensor lerp(const Tensor& a, const Tensor& b, float t)
     return (1.f - t) * a + t * b;
 }
 
+// Lazily built element-wise expression. Operators only record instructions;
+// eval() runs the whole chain as a single _eval dispatch with one output
+// allocation, and its backward is one more dispatch writing every input's
+// gradient. Inputs broadcast like the Tensor operators (trailing dimensions).
+//
+// usage: auto y = (x.expr() * 0.5f * (1.f + (x.expr() * c).tanh())).eval();
+class Expr
+{
+public:
+    Tensor eval() const;
+
+    Expr operator-() const;
+
+    Expr operator+(const Expr&) const;
+    Expr operator-(const Expr&) const;
+    Expr operator*(const Expr&) const;
+    Expr operator/(const Expr&) const;
+
+    Expr operator+(float) const;
+    Expr operator-(float) const;
+    Expr operator*(float) const;
+    Expr operator/(float) const;
+
+    Expr pow(const Expr&) const;
+    Expr pow(float) const;
+    Expr exp() const;
+    Expr log() const;
+    Expr tanh() const;
+    Expr cosh() const;
+    Expr sinh() const;
+    Expr relu(float = 0.f) const;
+
+private:
+    friend class Tensor;
+    friend Expr operator-(float, const Expr&);
+    friend Expr operator/(float, const Expr&);
+    Expr(std::shared_ptr<const ExprProgram>, uint32_t);
+    Expr binary(uint32_t op, const Expr&) const;
+    Expr binary(uint32_t op, float, bool reversed = false) const;
+    Expr unary(uint32_t op, float imm = 0.f) const;
+    std::shared_ptr<const ExprProgram> _program;
+    uint32_t _reg = 0;
+};
+
+inline Expr operator+(float x, const Expr& e)
+{
+    return e + x;
+}
+
+inline Expr operator*(float x, const Expr& e)
+{
+    return e * x;
+}
+
+Expr operator-(float, const Expr&);
+Expr operator/(float, const Expr&);
+
 inline std::ostream& operator<<(std::ostream& os, const Tensor& t)
 {
     return os << static_cast<std::string>(t);
@@ -143,7 +265,10 @@ public:
     virtual ~Device() = default;
     virtual void submit() = 0;
     virtual Tensor tensor(std::vector<float>, Shape = {}) = 0;
-    virtual Tensor rand(Shape) = 0;
+    virtual void seed(uint64_t) = 0;              // reseed rand/randn/bernoulli and restart their sequence
+    virtual Tensor rand(Shape) = 0;               // uniform in [0, 1)
+    virtual Tensor randn(Shape) = 0;              // standard normal
+    virtual Tensor bernoulli(Shape, float p) = 0; // 1 with probability p, else 0
     virtual Tensor zeros(Shape) = 0;
     virtual Tensor ones(Shape) = 0;
     virtual Tensor repeat(float, Shape) = 0;
@@ -181,11 +306,6 @@ public:
 
     virtual Tensor forward(const Tensor& in) override
     {
-        if (in.shape().size() > 2)
-        {
-            throw std::runtime_error("Unable to forward tensor with more than 2 dimensions");
-        }
-
         if (in.shape().size() == 1)
         {
             return in.reshape({ 1, in.shape().front() }).matmul(_weights) + _biases;
@@ -262,8 +382,27 @@ public:
 
     virtual void step() = 0;
 
+    // usage: optimizer.loss_scale(LossScale(65536.f, true));
+    //        optimizer.scale(loss).backward();
+    //        optimizer.step();
+    void loss_scale(const LossScale& scale)
+    {
+        _loss_scale = scale;
+    }
+
+    const LossScale& loss_scale() const
+    {
+        return _loss_scale;
+    }
+
+    Tensor scale(const Tensor& loss) const
+    {
+        return _loss_scale.scale(loss);
+    }
+
 protected:
     std::vector<Tensor> _parameters;
+    LossScale _loss_scale;
 };
 
 class SGD : public Optimizer
@@ -275,10 +414,7 @@ public:
 
     virtual void step() override
     {
-        for (auto& p : _parameters)
-        {
-            p.copy(p - _lr * p.grad());
-        }
+        Tensor::sgd(_parameters, _lr, _loss_scale);
     }
 
 private:
@@ -299,11 +435,7 @@ public:
 
     virtual void step() override
     {
-        ++_steps;
-        for (size_t i = 0; i < _parameters.size(); i++)
-        {
-            _parameters[i].copy(_parameters[i] - _lr * _parameters[i].grad().adam(_mean[i], _variance[i], _steps));
-        }
+        Tensor::adam(_parameters, _mean, _variance, ++_steps, _lr, 0.9, 0.999, _loss_scale);
     }
 
 private:
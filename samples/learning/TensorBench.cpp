@@ -0,0 +1,476 @@
+// Headless tensor kernel benchmark (scratch regression tool).
+//
+//   reduce -- sum, dot, mean and max over 1e3..1e8 elements; reports GB/s of
+//             input read and checks the result against a CPU reference
+//   matmul -- square and autoencoder-shaped products, forward alone and
+//             forward + backward (whose two products read an operand
+//             transposed); reports GFLOP/s and spot-checks the forward.
+//             Run once more with TENSOR_MATMUL=naive for the untiled baseline
+//   bmatmul -- [B,M,K]x[B,K,N] as one batched dispatch against a CPU loop of
+//             per-item products over slices
+//   gelu    -- the fused Expr gelu against the same formula as one dispatch
+//             per Tensor op, forward alone and forward + backward; the two
+//             must agree to 1e-4 or the run fails
+//   random  -- GPU rand/randn/bernoulli and fills; reports GB/s written and
+//             the sample mean and standard deviation
+//   adam    -- one fused Adam step over all layers of an MLP against the
+//             per-parameter adam() + copy() sequence
+//   mixed   -- fp16 and bf16 matmuls against fp32 (relative RMS error of the
+//             whole product), and a small regression trained through 16-bit
+//             copies of fp32 weights with dynamic loss scaling; its final loss
+//             should match the fp32 run. Errors past the per-dtype bounds in
+//             `mixedBounds` fail the run (exit code 1)
+//
+// Each measurement records `repeats` ops, submits once and blocks on the last
+// result, so small sizes mostly measure per-dispatch overhead.
+//
+// Run from the build/bin directory (loads shaders/learning/Tensor.spv). The
+// optional argument picks the device index (lavapipe is usually the last).
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "Tensor.h"
+
+namespace
+{
+
+    double msSince(std::chrono::steady_clock::time_point t0)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // Times `repeats` back-to-back ops; the last one is read back.
+    double timeOp(Device* device, int repeats, const std::function<Tensor()>& op, float& result)
+    {
+        op().cpu(); // warm up allocators and pipelines
+        auto t0 = std::chrono::steady_clock::now();
+        Tensor last;
+        for (int i = 0; i < repeats; i++)
+        {
+            last = op();
+        }
+        device->submit();
+        result = last.cpu().front();
+        return msSince(t0) / repeats;
+    }
+
+    void benchReduce(Device* device)
+    {
+        std::printf("reduce\n%12s %8s %10s %10s %12s\n", "elements", "op", "ms", "GB/s", "rel. error");
+        for (uint64_t n = 1000; n <= 100000000; n *= 10)
+        {
+            std::vector<float> data(n);
+            double sum = 0.0, dot = 0.0;
+            float max = -INFINITY;
+            for (uint64_t i = 0; i < n; i++)
+            {
+                data[i] = static_cast<float>((i * 2654435761u) % 1000) / 1000.f;
+                sum += data[i];
+                dot += static_cast<double>(data[i]) * data[i];
+                max = std::fmax(max, data[i]);
+            }
+            auto x = device->tensor(data);
+            const int repeats = n >= 10000000 ? 5 : 50;
+
+            struct Case
+            {
+                const char* name;
+                std::function<Tensor()> op;
+                double reference;
+                int inputs;
+            } cases[] = {
+                { "sum", [&] { return x.sum(); }, sum, 1 },
+                { "dot", [&] { return x.dot(x); }, dot, 2 },
+                { "mean", [&] { return x.mean(); }, sum / n, 1 },
+                { "max", [&] { return x.max(); }, max, 1 },
+            };
+            for (auto& c : cases)
+            {
+                float result = 0.f;
+                double ms = timeOp(device, repeats, c.op, result);
+                double gbs = (n * sizeof(float) * c.inputs) / (ms * 1e6);
+                double error = std::fabs(result - c.reference) / std::fmax(std::fabs(c.reference), 1e-30);
+                std::printf("%12llu %8s %10.3f %10.2f %12.2e\n", static_cast<unsigned long long>(n), c.name, ms, gbs, error);
+            }
+        }
+    }
+
+    void benchMatmul(Device* device)
+    {
+        const char* kernel = std::getenv("TENSOR_MATMUL");
+        std::printf("\nmatmul (%s)\n%6s %6s %6s %6s %10s %10s %12s\n", kernel ? kernel : "tiled", "M", "K", "N", "op", "ms", "GFLOP/s", "rel. error");
+
+        struct Shape3
+        {
+            unsigned int m, k, n;
+        } shapes[] = {
+            { 1, 4096, 256 }, { 64, 64, 64 }, { 256, 256, 256 }, { 512, 512, 512 }, { 1024, 1024, 1024 },
+            { 2048, 2048, 2048 }, { 4096, 256, 4096 }, { 256, 4096, 256 }, { 40, 1000, 40 },
+            { 1, 196608, 256 }, { 1, 256, 196608 }, // Learning.cpp encoder and decoder, batch of one
+        };
+        for (auto shape : shapes)
+        {
+            std::vector<float> a(static_cast<size_t>(shape.m) * shape.k);
+            std::vector<float> b(static_cast<size_t>(shape.k) * shape.n);
+            for (size_t i = 0; i < a.size(); i++)
+            {
+                a[i] = static_cast<float>((i * 2654435761u) % 200) / 100.f - 1.f;
+            }
+            for (size_t i = 0; i < b.size(); i++)
+            {
+                b[i] = static_cast<float>((i * 40503u) % 200) / 100.f - 1.f;
+            }
+            auto x = device->tensor(a, { shape.m, shape.k });
+            auto y = device->tensor(b, { shape.k, shape.n });
+            const double flops = 2.0 * shape.m * shape.k * shape.n;
+            const int repeats = flops > 4e9 ? 3 : 20;
+
+            // reference for the last element of the product
+            double reference = 0.0;
+            for (unsigned int k = 0; k < shape.k; k++)
+            {
+                reference += static_cast<double>(a[static_cast<size_t>(shape.m - 1) * shape.k + k]) * b[static_cast<size_t>(k) * shape.n + shape.n - 1];
+            }
+
+            struct Case
+            {
+                const char* name;
+                std::function<Tensor()> op;
+                double flops; // multiple of the forward product
+                bool checked;
+            } cases[] = {
+                { "fwd", [&] { return x.matmul(y); }, 1.0, true },
+                { "train", [&]
+                  {
+                      x.zero();
+                      y.zero();
+                      x.matmul(y).backward();
+                      return x.grad();
+                  },
+                  3.0, false },
+            };
+            for (auto& c : cases)
+            {
+                c.op().cpu(); // warm up
+                auto t0 = std::chrono::steady_clock::now();
+                Tensor last;
+                for (int i = 0; i < repeats; i++)
+                {
+                    last = c.op();
+                }
+                device->submit();
+                float result = last.cpu().back();
+                double ms = msSince(t0) / repeats;
+                double error = c.checked ? std::fabs(result - reference) / std::fmax(std::fabs(reference), 1e-6) : 0.0;
+                std::printf("%6u %6u %6u %6s %10.3f %10.2f %12.2e\n", shape.m, shape.k, shape.n, c.name, ms, c.flops * flops / (ms * 1e6), error);
+            }
+        }
+    }
+
+    void benchBatchedMatmul(Device* device)
+    {
+        std::printf("\nbmatmul\n%6s %6s %6s %6s %8s %10s %10s\n", "B", "M", "K", "N", "op", "ms", "GFLOP/s");
+        const unsigned int shapes[][4] = { { 64, 32, 32, 32 }, { 32, 128, 64, 128 }, { 8, 512, 512, 512 } };
+        for (auto& shape : shapes)
+        {
+            const unsigned int b = shape[0], m = shape[1], k = shape[2], n = shape[3];
+            auto x = device->tensor(std::vector<float>(static_cast<size_t>(b) * m * k, 0.5f), { b, m, k });
+            auto y = device->tensor(std::vector<float>(static_cast<size_t>(b) * k * n, 0.25f), { b, k, n });
+            const double flops = 2.0 * b * m * k * n;
+
+            struct Case
+            {
+                const char* name;
+                std::function<Tensor()> op;
+            } cases[] = {
+                { "batched", [&] { return x.matmul(y); } },
+                { "loop", [&]
+                  {
+                      Tensor last;
+                      for (unsigned int i = 0; i < b; i++)
+                      {
+                          last = x[i].matmul(y[i]);
+                      }
+                      return last;
+                  } },
+            };
+            for (auto& c : cases)
+            {
+                float result = 0.f;
+                double ms = timeOp(device, 10, c.op, result);
+                std::printf("%6u %6u %6u %6u %8s %10.3f %10.2f\n", b, m, k, n, c.name, ms, flops / (ms * 1e6));
+            }
+        }
+    }
+
+    // Returns false when the fused and per-op results disagree.
+    bool benchGelu(Device* device)
+    {
+        bool passed = true;
+        std::printf("\ngelu\n%12s %8s %10s %10s %10s %10s %12s\n", "elements", "op", "fused ms", "ops ms", "speedup", "fused GB/s", "max |diff|");
+        const float k = std::sqrt(2.f / 3.1415926535f);
+        for (uint64_t n = 1000; n <= 10000000; n *= 100)
+        {
+            device->seed(4);
+            auto x = device->randn({ static_cast<unsigned int>(n) });
+            auto ops = [&] { return x * 0.5f * (1.f + (k * (x + x * x * x * 0.044715f)).tanh()); };
+
+            struct Case
+            {
+                const char* name;
+                std::function<Tensor()> fused;
+                std::function<Tensor()> ops;
+            } cases[] = {
+                { "fwd", [&] { return x.gelu(); }, ops },
+                { "train", [&]
+                  {
+                      x.zero();
+                      x.gelu().backward();
+                      return x.grad();
+                  },
+                  [&]
+                  {
+                      x.zero();
+                      ops().backward();
+                      return x.grad();
+                  } },
+            };
+            for (auto& c : cases)
+            {
+                float result = 0.f;
+                double fusedMs = timeOp(device, 20, c.fused, result);
+                double opsMs = timeOp(device, 20, c.ops, result);
+
+                // Same formula either way; only rounding order differs.
+                auto fused = c.fused().cpu();
+                auto reference = c.ops().cpu();
+                double diff = 0.0;
+                for (size_t i = 0; i < fused.size(); i++)
+                {
+                    diff = std::fmax(diff, std::fabs(static_cast<double>(fused[i]) - reference[i]));
+                }
+                std::printf("%12llu %8s %10.3f %10.3f %9.1fx %10.2f %12.2e\n", static_cast<unsigned long long>(n), c.name, fusedMs, opsMs, opsMs / fusedMs,
+                            (2.0 * n * sizeof(float)) / (fusedMs * 1e6), diff);
+                if (!(diff <= 1e-4))
+                {
+                    std::fprintf(stderr, "gelu %s, %llu elements: fused and per-op results differ by %.2e\n", c.name, static_cast<unsigned long long>(n), diff);
+                    passed = false;
+                }
+            }
+        }
+        return passed;
+    }
+
+    void benchRandom(Device* device)
+    {
+        std::printf("\nrandom\n%12s %10s %10s %10s %10s %10s\n", "elements", "op", "ms", "GB/s", "mean", "std");
+        for (uint64_t n = 1000; n <= 10000000; n *= 100)
+        {
+            Shape shape = { static_cast<unsigned int>(n) };
+
+            struct Case
+            {
+                const char* name;
+                std::function<Tensor()> op;
+            } cases[] = {
+                { "rand", [&] { return device->rand(shape); } },
+                { "randn", [&] { return device->randn(shape); } },
+                { "bernoulli", [&] { return device->bernoulli(shape, 0.25f); } },
+                { "zeros", [&] { return device->zeros(shape); } },
+            };
+            for (auto& c : cases)
+            {
+                float result = 0.f;
+                double ms = timeOp(device, 20, c.op, result);
+                auto x = c.op();
+                float mean = x.mean().cpu().front();
+                float deviation = std::sqrt(std::fmax((x * x).mean().cpu().front() - mean * mean, 0.f));
+                std::printf("%12llu %10s %10.3f %10.2f %10.4f %10.4f\n", static_cast<unsigned long long>(n), c.name, ms, (n * sizeof(float)) / (ms * 1e6), mean, deviation);
+            }
+        }
+    }
+
+    void benchAdam(Device* device)
+    {
+        std::printf("\nadam\n%8s %8s %10s %10s\n", "layers", "width", "op", "ms");
+        for (unsigned int layers : { 2u, 8u, 32u })
+        {
+            const unsigned int width = 256;
+            Sequential model(device, Shape(layers + 1, width));
+            auto parameters = model.parameters();
+            model.forward(device->rand({ 16, width })).backward();
+
+            std::vector<Tensor> mean, variance;
+            for (auto& p : parameters)
+            {
+                mean.push_back(device->zeros(p.shape()));
+                variance.push_back(device->zeros(p.shape()));
+            }
+
+            uint64_t steps = 0;
+            struct Case
+            {
+                const char* name;
+                std::function<Tensor()> op;
+            } cases[] = {
+                { "fused", [&]
+                  {
+                      Tensor::adam(parameters, mean, variance, ++steps, 1e-3f);
+                      return parameters.back();
+                  } },
+                { "tensor", [&]
+                  {
+                      ++steps;
+                      for (size_t i = 0; i < parameters.size(); i++)
+                      {
+                          parameters[i].copy(parameters[i] - 1e-3f * parameters[i].grad().adam(mean[i], variance[i], steps));
+                      }
+                      return parameters.back();
+                  } },
+            };
+            for (auto& c : cases)
+            {
+                float result = 0.f;
+                double ms = timeOp(device, 20, c.op, result);
+                std::printf("%8u %8u %10s %10.3f\n", layers, width, c.name, ms);
+            }
+        }
+    }
+
+    const char* dtypeName(DTYPE dtype)
+    {
+        return dtype == DTYPE_F16 ? "fp16" : dtype == DTYPE_BF16 ? "bf16" : "fp32";
+    }
+
+    // Rounding both operands to 16 bits leaves a relative error of a few ulps
+    // of the narrow mantissa (2^-11 for fp16, 2^-8 for bf16) in the product;
+    // fp32 is checked against itself and only absorbs reordering. The final
+    // loss may sit above the fp32 one by the given factor.
+    struct MixedBound
+    {
+        DTYPE dtype;
+        double matmul_error;
+        double loss_ratio;
+    };
+
+    const MixedBound mixedBounds[] = {
+        { DTYPE_F32, 1e-5, 1.0 },
+        { DTYPE_F16, 2e-3, 1.5 },
+        { DTYPE_BF16, 1.5e-2, 4.0 },
+    };
+
+    // Returns false when any error is past its bound.
+    bool benchMixed(Device* device)
+    {
+        bool passed = true;
+
+        std::printf("\nmixed matmul\n%6s %6s %6s %6s %10s %10s %12s\n", "M", "K", "N", "dtype", "ms", "GFLOP/s", "rel. error");
+        const unsigned int shapes[][3] = { { 256, 256, 256 }, { 1024, 1024, 1024 }, { 4096, 256, 4096 }, { 256, 4096, 256 } };
+        for (auto& shape : shapes)
+        {
+            const unsigned int m = shape[0], k = shape[1], n = shape[2];
+            device->seed(1);
+            auto x = device->randn({ m, k });
+            auto y = device->randn({ k, n });
+            auto reference = x.matmul(y);
+            float norm = (reference * reference).mean().cpu().front();
+            const double flops = 2.0 * m * k * n;
+
+            for (auto& bound : mixedBounds)
+            {
+                const DTYPE dtype = bound.dtype;
+                auto x16 = x.to(dtype);
+                auto y16 = y.to(dtype);
+                float result = 0.f;
+                double ms = timeOp(device, 10, [&] { return x16.matmul(y16); }, result);
+                auto dif = x16.matmul(y16) - reference;
+                double error = std::sqrt((dif * dif).mean().cpu().front() / norm);
+                std::printf("%6u %6u %6u %6s %10.3f %10.2f %12.2e\n", m, k, n, dtypeName(dtype), ms, flops / (ms * 1e6), error);
+                if (!(error <= bound.matmul_error))
+                {
+                    std::fprintf(stderr, "mixed matmul %ux%ux%u %s: rel. error %.2e over %.2e\n", m, k, n, dtypeName(dtype), error, bound.matmul_error);
+                    passed = false;
+                }
+            }
+        }
+
+        std::printf("\nmixed training\n%6s %10s %12s %12s\n", "dtype", "ms/step", "loss", "loss scale");
+        const unsigned int width = 256, batch = 64;
+        const int steps = 200;
+        device->seed(2);
+        auto inputs = device->randn({ batch, width });
+        auto target = inputs.matmul(device->randn({ width, width }) * 0.1f).detach();
+        float reference = 0.f;
+        for (auto& bound : mixedBounds)
+        {
+            const DTYPE dtype = bound.dtype;
+            device->seed(3);
+            auto weights = (device->randn({ width, width }) * 0.1f).detach();
+            Adam optimizer({ weights }, 1e-2f);
+            if (dtype != DTYPE_F32)
+            {
+                optimizer.loss_scale(LossScale(65536.f, true));
+            }
+
+            auto data = inputs.to(dtype);
+            Tensor loss;
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < steps; i++)
+            {
+                optimizer.zero_grad();
+                loss = data.matmul(weights.to(dtype)).mse(target);
+                optimizer.scale(loss).backward();
+                optimizer.step();
+            }
+            device->submit();
+            float result = loss.cpu().front();
+            double ms = msSince(t0) / steps;
+            std::printf("%6s %10.3f %12.4e %12.0f\n", dtypeName(dtype), ms, result, optimizer.loss_scale().value());
+            if (dtype == DTYPE_F32)
+            {
+                reference = result;
+            }
+            else if (!(result <= reference * bound.loss_ratio))
+            {
+                std::fprintf(stderr, "mixed training %s: final loss %.4e over %.1fx the fp32 loss %.4e\n", dtypeName(dtype), result, bound.loss_ratio, reference);
+                passed = false;
+            }
+        }
+        return passed;
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int deviceIndex = argc > 1 ? std::atoi(argv[1]) : 0;
+
+    Instance instance;
+    auto device = instance.device(deviceIndex);
+    try
+    {
+        benchReduce(device);
+        benchMatmul(device);
+        benchBatchedMatmul(device);
+        bool passed = benchGelu(device);
+        benchRandom(device);
+        benchAdam(device);
+        passed &= benchMixed(device);
+        if (!passed)
+        {
+            return 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
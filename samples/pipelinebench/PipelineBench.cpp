@@ -0,0 +1,130 @@
+// Headless pipeline-creation startup benchmark (scratch regression tool).
+//
+// Simulates a renderer creating its pipelines at startup, drawn from the
+// compiled sample shaders (compute entry points plus the graphics pair):
+//   one-by-one -- one gpuCreate*Pipeline call at a time on this thread
+//   batch      -- the same descs through gpuCreate*Pipelines (chunked, all
+//                 cores)
+// Both passes chain the SPIR-V into the stage (maintenance5) and share the
+// same per-pipeline setup, so the ratio is what chunking and threads buy; it
+// is not a comparison against the old one-VkShaderModule-per-call path.
+// Cross-check: every handle from both passes must be non-null.
+//
+// Run from the build/bin directory (loads shaders/*/*.spv). Disable the
+// driver's on-disk shader cache (MESA_SHADER_CACHE_DISABLE=true on Mesa), or
+// the second pass mostly measures cache hits.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "NoGraphicsAPI.h"
+#include "Utilities.h" // loadIR
+
+namespace
+{
+
+    double msSince(std::chrono::steady_clock::time_point t0)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const uint32_t pipelineCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 2000;
+
+    gpuCreateInstance();
+
+    auto desc = gpuDeviceDesc(0);
+    auto device = gpuCreateDevice(0);
+    if (!device)
+    {
+        std::printf("no usable device\n");
+        return 1;
+    }
+    std::printf("device: %s (%s), %u hardware threads\n\n", desc.name, desc.discrete ? "discrete" : "integrated", std::thread::hardware_concurrency());
+
+    auto computeIR = loadIR("shaders/compute/Compute.spv");
+    auto threadsIR = loadIR("shaders/multithreading/Multithreading.spv");
+    auto tensorIR = loadIR("shaders/learning/Tensor.spv");
+    auto vertexIR = loadIR("shaders/graphics/Vertex.spv");
+    auto pixelIR = loadIR("shaders/graphics/Pixel.spv");
+
+    // Every fourth pipeline is graphics; the rest cycle through compute entries.
+    const GpuComputePipelineDesc computeKinds[] = {
+        { ByteSpan(computeIR), "main" },
+        { ByteSpan(threadsIR), "main" },
+        { ByteSpan(tensorIR), "_add" },
+        { ByteSpan(tensorIR), "_matmul" },
+        { ByteSpan(tensorIR), "_adam" },
+        { ByteSpan(tensorIR), "_tanh" },
+    };
+    const uint32_t computeKindCount = sizeof(computeKinds) / sizeof(computeKinds[0]);
+
+    ColorTarget colorTargets[2] = {};
+    colorTargets[0].format = FORMAT_RGBA8_UNORM;
+    colorTargets[1].format = FORMAT_RGBA32_FLOAT;
+    const CULL culls[] = { CULL_NONE, CULL_CW, CULL_CCW };
+
+    std::vector<GpuComputePipelineDesc> computeDescs;
+    std::vector<GpuGraphicsPipelineDesc> graphicsDescs;
+    for (uint32_t i = 0; i < pipelineCount; i++)
+    {
+        if (i % 4 == 3)
+        {
+            graphicsDescs.push_back(GpuGraphicsPipelineDesc{
+                .vertexIR = ByteSpan(vertexIR),
+                .pixelIR = ByteSpan(pixelIR),
+                .raster = {
+                    .cull = culls[i % 3],
+                    .depthFormat = FORMAT_D32_FLOAT,
+                    .colorTargets = Span<ColorTarget>(colorTargets, 2) } });
+        }
+        else
+        {
+            computeDescs.push_back(computeKinds[i % computeKindCount]);
+        }
+    }
+
+    std::vector<GpuPipeline> oneByOne, batch(computeDescs.size() + graphicsDescs.size());
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (auto& d : computeDescs)
+        oneByOne.push_back(gpuCreateComputePipeline(device, d.computeIR, d.entry));
+    for (auto& d : graphicsDescs)
+        oneByOne.push_back(gpuCreateGraphicsPipeline(device, d.vertexIR, d.pixelIR, d.raster));
+    double oneByOneMs = msSince(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    gpuCreateComputePipelines(device, computeDescs, Span<GpuPipeline>(batch.data(), computeDescs.size()));
+    gpuCreateGraphicsPipelines(device, graphicsDescs, Span<GpuPipeline>(batch.data() + computeDescs.size(), graphicsDescs.size()));
+    double batchMs = msSince(t0);
+
+    bool ok = oneByOne.size() == batch.size();
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        ok &= oneByOne[i] != nullptr && batch[i] != nullptr;
+    }
+
+    std::printf("%-10s %12s %15s\n", "pass", "total ms", "us/pipeline");
+    std::printf("%-10s %9.3f ms %12.3f us\n", "one-by-one", oneByOneMs, oneByOneMs * 1000.0 / pipelineCount);
+    std::printf("%-10s %9.3f ms %12.3f us\n", "batch", batchMs, batchMs * 1000.0 / pipelineCount);
+    std::printf("\nchunked + threaded over one-by-one, same inline-SPIR-V setup: %.1fx (%zu compute, %zu graphics)\n", oneByOneMs / batchMs, computeDescs.size(), graphicsDescs.size());
+
+    if (!ok)
+    {
+        std::printf("\nCROSS-CHECK FAILURE\n");
+    }
+
+    for (auto pipeline : oneByOne)
+        gpuFreePipeline(pipeline);
+    for (auto pipeline : batch)
+        gpuFreePipeline(pipeline);
+    gpuDestroyDevice(device);
+    gpuDestroyInstance();
+    return ok ? 0 : 1;
+}
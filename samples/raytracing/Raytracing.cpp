@@ -338,7 +338,7 @@ int main()
             instances.cpu[i].instanceMask = 0xFF;
             instances.cpu[i].hitGroupIndex = 0;
             instances.cpu[i].flags = 0;
-            instances.cpu[i].blasAddress = blasPtr;
+            instances.cpu[i].blasAddress = gpuAccelerationStructureAddress(blas);
         }
     }
 
@@ -361,7 +361,11 @@ int main()
     void* tlasPtr = gpuMalloc(device, tlasSize.size, MEMORY_GPU);
     auto tlas = gpuCreateAccelerationStructure(device, tlasDesc, tlasPtr, tlasSize.size);
 
-    size_t scratchSize = std::max(blasSize.buildScratchSize, tlasSize.buildScratchSize);
+    // BLAS and TLAS are built in separate batches (the TLAS reads the BLAS),
+    // so one scratch range sized for the larger batch serves both.
+    size_t scratchSize = std::max(
+        gpuAccelerationStructureScratchSize(Span<GpuAccelerationStructure>(&blas, 1), MODE_BUILD),
+        gpuAccelerationStructureScratchSize(Span<GpuAccelerationStructure>(&tlas, 1), MODE_BUILD));
     void* scratchPtr = gpuMalloc(device, scratchSize, MEMORY_GPU);
 
     // ReSTIR buffers
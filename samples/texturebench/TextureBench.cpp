@@ -0,0 +1,165 @@
+// Headless gpuTextureSizeAlign benchmark (scratch regression tool).
+//
+// Simulates an asset loader sizing 50k textures before allocating them:
+//   image  -- baseline: the pre-memo path, a VkImage created, asked for its
+//             memory requirements and destroyed per desc
+//   cold   -- every desc is new, so each call is a driver query
+//   warm   -- the same descs again, served from the per-device memo
+//   loader -- 50k descs drawn from a realistic mix of a few hundred shapes,
+//             timed both ways
+// Cross-check: every memo answer (size, alignment and allowed memory types)
+// must equal the one from a real image.
+//
+// Run from the build/bin directory.
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#define GPU_EXPOSE_INTERNAL
+#include "NoGraphicsAPI.h"
+
+namespace
+{
+
+    uint32_t hash32(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    uint32_t mipCountFor(uint32_t width, uint32_t height)
+    {
+        uint32_t mips = 1;
+        while ((width | height) >> mips)
+            mips++;
+        return mips;
+    }
+
+    // Returns total milliseconds for sizing every desc once.
+    double timeSizing(GpuDevice device, const std::vector<GpuTextureDesc>& descs, std::vector<GpuTextureSizeAlign>& out)
+    {
+        out.resize(descs.size());
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < descs.size(); i++)
+            out[i] = gpuTextureSizeAlign(device, descs[i]);
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(t1 - t0).count();
+    }
+
+    // The same through a real VkImage per desc.
+    double timeImageSizing(GpuDevice device, const std::vector<GpuTextureDesc>& descs, std::vector<GpuTextureMemoryRequirements>& out)
+    {
+        out.resize(descs.size());
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < descs.size(); i++)
+            out[i] = gpuTextureMemoryRequirementsFromImage(device, descs[i]);
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(t1 - t0).count();
+    }
+
+    // Counts descs whose memo answer differs from the image's.
+    uint32_t crossCheck(GpuDevice device, const std::vector<GpuTextureDesc>& descs, const std::vector<GpuTextureSizeAlign>& timed,
+                        const std::vector<GpuTextureMemoryRequirements>& image)
+    {
+        uint32_t mismatches = 0;
+        for (size_t i = 0; i < descs.size(); i++)
+        {
+            GpuTextureMemoryRequirements cached = gpuTextureMemoryRequirements(device, descs[i]);
+            bool ok = cached.size == image[i].size && cached.align == image[i].align && cached.memoryTypeBits == image[i].memoryTypeBits;
+            ok &= timed[i].size == image[i].size && timed[i].align == image[i].align;
+            ok &= image[i].size > 0;
+            if (!ok)
+                mismatches++;
+        }
+        return mismatches;
+    }
+
+} // namespace
+
+int main()
+{
+    gpuCreateInstance();
+
+    auto desc = gpuDeviceDesc(0);
+    auto device = gpuCreateDevice(0);
+    if (!device)
+    {
+        std::printf("no usable device\n");
+        return 1;
+    }
+    std::printf("device: %s (%s)\n\n", desc.name, desc.discrete ? "discrete" : "integrated");
+
+    const uint32_t textureCount = 50000;
+    const FORMAT formats[] = { FORMAT_RGBA8_UNORM, FORMAT_RGBA8_SRGB, FORMAT_RG8_UNORM, FORMAT_R8_UNORM, FORMAT_RGBA16_FLOAT };
+    const uint32_t formatCount = sizeof(formats) / sizeof(formats[0]);
+
+    // All-unique shapes: width varies per texture so no two descs match.
+    std::vector<GpuTextureDesc> unique(textureCount);
+    for (uint32_t i = 0; i < textureCount; i++)
+    {
+        uint32_t width = 16 + i;
+        uint32_t height = 16 + hash32(i) % 1024;
+        unique[i] = GpuTextureDesc{
+            .type = TEXTURE_2D,
+            .dimensions = { width, height, 1 },
+            .mipCount = 1,
+            .format = formats[i % formatCount],
+            .usage = static_cast<USAGE_FLAGS>(USAGE_SAMPLED | USAGE_TRANSFER_DST)
+        };
+    }
+
+    // Loader mix: power-of-two sizes 32..4096, full mip chains, a few formats.
+    std::vector<GpuTextureDesc> loader(textureCount);
+    for (uint32_t i = 0; i < textureCount; i++)
+    {
+        uint32_t h = hash32(i + 0x9e3779b9u);
+        uint32_t width = 32u << (h % 8);
+        uint32_t height = 32u << ((h >> 8) % 8);
+        loader[i] = GpuTextureDesc{
+            .type = TEXTURE_2D,
+            .dimensions = { width, height, 1 },
+            .mipCount = mipCountFor(width, height),
+            .format = formats[(h >> 16) % formatCount],
+            .usage = static_cast<USAGE_FLAGS>(USAGE_SAMPLED | USAGE_TRANSFER_DST)
+        };
+    }
+
+    // The image passes run first so neither benefits from the memo.
+    std::vector<GpuTextureMemoryRequirements> uniqueImage, loaderImage;
+    double imageMs = timeImageSizing(device, unique, uniqueImage);
+    double loaderImageMs = timeImageSizing(device, loader, loaderImage);
+
+    std::vector<GpuTextureSizeAlign> first, second, mixed;
+    double coldMs = timeSizing(device, unique, first);
+    double warmMs = timeSizing(device, unique, second);
+    double loaderMs = timeSizing(device, loader, mixed);
+
+    uint32_t mismatches = crossCheck(device, unique, first, uniqueImage);
+    mismatches += crossCheck(device, unique, second, uniqueImage);
+    mismatches += crossCheck(device, loader, mixed, loaderImage);
+
+    std::printf("%-14s %12s %14s\n", "pass", "total ms", "us/texture");
+    std::printf("%-14s %9.3f ms %11.3f us\n", "image", imageMs, imageMs * 1000.0 / textureCount);
+    std::printf("%-14s %9.3f ms %11.3f us\n", "cold", coldMs, coldMs * 1000.0 / textureCount);
+    std::printf("%-14s %9.3f ms %11.3f us\n", "warm", warmMs, warmMs * 1000.0 / textureCount);
+    std::printf("%-14s %9.3f ms %11.3f us\n", "loader (image)", loaderImageMs, loaderImageMs * 1000.0 / textureCount);
+    std::printf("%-14s %9.3f ms %11.3f us\n", "loader", loaderMs, loaderMs * 1000.0 / textureCount);
+    std::printf("\ncold speedup over image:   %.1fx\n", imageMs / coldMs);
+    std::printf("warm speedup over image:   %.1fx\n", imageMs / warmMs);
+    std::printf("loader speedup over image: %.1fx\n", loaderImageMs / loaderMs);
+
+    bool ok = mismatches == 0;
+    if (!ok)
+    {
+        std::printf("\nCROSS-CHECK FAILURE: %u answers differ from a real image's\n", mismatches);
+    }
+
+    gpuDestroyDevice(device);
+    gpuDestroyInstance();
+    return ok ? 0 : 1;
+}
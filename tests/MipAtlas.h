@@ -0,0 +1,17 @@
+#ifndef TESTS_SHADER_MIP_ATLAS_H
+#define TESTS_SHADER_MIP_ATLAS_H
+
+#include "NoGraphicsAPI.h"
+
+// Lays every level of a mip chain out in one atlas: mip 0 at the origin, the
+// rest stacked top to bottom in a column to its right.
+struct alignas(16) MipAtlasData
+{
+    uint2 atlasSize;
+    uint2 mip0Size;
+    uint srcTexture;
+    uint dstTexture;
+    uint mipCount;
+};
+
+#endif // TESTS_SHADER_MIP_ATLAS_H
@@ -0,0 +1,28 @@
+#ifndef TESTS_SHADER_RASTER_H
+#define TESTS_SHADER_RASTER_H
+
+#include "NoGraphicsAPI.h"
+
+// Flat-coloured geometry for the raster tests: clip-space positions and
+// colors, one per vertex index, with no transform.
+struct alignas(16) RasterVertexData
+{
+    float4* positions;
+    float4* colors;
+};
+
+// Multiview variant: view i shifts the geometry by viewOffsets[i] in clip
+// space x, so every layer of the pass differs.
+struct alignas(16) RasterMultiviewData
+{
+    float4* positions;
+    float4* colors;
+    float4 viewOffsets; // one per view, x = view 0, y = view 1, ...
+};
+
+struct alignas(16) RasterPixelData
+{
+    float4 tint; // multiplied into the interpolated color
+};
+
+#endif // TESTS_SHADER_RASTER_H
@@ -0,0 +1,26 @@
+#ifndef TESTS_SHADER_TLAS_INSTANCES_H
+#define TESTS_SHADER_TLAS_INSTANCES_H
+
+#include "NoGraphicsAPI.h"
+
+#ifdef __cplusplus
+#define TlasInstance GpuAccelerationStructureInstanceDesc
+#else
+#define TlasInstance GpuAccelerationStructureInstance
+#endif
+
+// Writes a TLAS instance array and its build range on the GPU: the first
+// `count` slots take the source instances with blasAddress filled in, the
+// rest up to `capacity` are left inactive (a null BLAS) so a build over the
+// whole capacity sees the same scene, and range gets the live count.
+struct alignas(16) TlasInstancesData
+{
+    TlasInstance* source;               // count instances, blasAddress ignored
+    TlasInstance* instances;            // capacity slots, the TLAS's instancesGpu
+    uint* range;                        // GpuAccelerationStructureBuildRange
+    AccelerationStructure blasAddress;  // from gpuAccelerationStructureAddress
+    uint count;
+    uint capacity;
+};
+
+#endif // TESTS_SHADER_TLAS_INSTANCES_H
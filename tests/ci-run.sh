@@ -40,13 +40,20 @@ cmake --build "$BUILD" -j"$(nproc)"
 cd "$BUILD/bin"
 
 status=0
-for t in test_compute test_graphics test_raytracing test_msdf; do
+for t in test_compute test_graphics test_raytracing test_raytracing_indirect test_msdf test_mips test_bc test_msaa test_stencil test_multiview test_lines test_specialization test_copy; do
     echo "==> $t ${MODE_ARGS[*]} ${EXTRA_ARGS[*]}"
     if ! "./$t" "${MODE_ARGS[@]}" "${EXTRA_ARGS[@]}"; then
         status=1
     fi
 done
 
+# Once more on the direct-build fallback, which devices without indirect
+# acceleration structure builds take anyway.
+echo "==> test_raytracing_indirect (NGAPI_NO_INDIRECT_AS_BUILD=1) ${MODE_ARGS[*]} ${EXTRA_ARGS[*]}"
+if ! NGAPI_NO_INDIRECT_AS_BUILD=1 ./test_raytracing_indirect "${MODE_ARGS[@]}" "${EXTRA_ARGS[@]}"; then
+    status=1
+fi
+
 if [[ ${#MODE_ARGS[@]} -gt 0 ]]; then
     echo "==> Goldens written to $ROOT/tests/reference"
 fi
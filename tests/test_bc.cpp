@@ -0,0 +1,213 @@
+// Headless test for block-compressed uploads: encode a BC1 and a BC7 texture on
+// the CPU, upload each with gpuCopyToTexture, decode them on the GPU through the
+// MipAtlas pass (a single level is just a copy) and compare both, side by side,
+// to a golden. Skipped on devices that can't sample either format.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator, loadIR
+#include "MipAtlas.h"  // MipAtlasData
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// RGB565 from 8-bit channels.
+static uint16_t rgb565(uint32_t r, uint32_t g, uint32_t b)
+{
+    return static_cast<uint16_t>((r >> 3) << 11 | (g >> 2) << 5 | (b >> 3));
+}
+
+// BC1, four-colour mode (c0 > c1, which c0's full red guarantees): a horizontal
+// ramp from c0 to c1 in each block. Palette indices 0, 2, 3, 1 are c0,
+// 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1, c1.
+static void encodeBC1(uint8_t* out, uint32_t bx, uint32_t by)
+{
+    const uint16_t c0 = rgb565(255, 64 + by * 12, bx * 16);
+    const uint16_t c1 = rgb565(bx * 8, 32, 255 - by * 16);
+    const uint32_t ramp[4] = { 0, 2, 3, 1 };
+    uint32_t indices = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        indices |= ramp[i % 4] << (i * 2);
+    }
+    memcpy(out, &c0, 2);
+    memcpy(out + 2, &c1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+// BC7 mode 6: one subset, RGBA 7-bit endpoints plus a p-bit each, 4-bit
+// indices (the anchor, texel 0, stores 3). A diagonal ramp per block.
+static void encodeBC7(uint8_t* out, uint32_t bx, uint32_t by)
+{
+    const uint32_t e0[4] = { bx * 8, 127 - by * 8, 64, 127 };
+    const uint32_t e1[4] = { 127, by * 8, 127 - bx * 8, 127 };
+
+    uint8_t block[16] = {};
+    uint32_t bit = 0;
+    auto put = [&](uint32_t value, uint32_t bits)
+    {
+        for (uint32_t i = 0; i < bits; i++, bit++)
+        {
+            block[bit / 8] |= ((value >> i) & 1) << (bit % 8);
+        }
+    };
+    put(1 << 6, 7);
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        put(e0[c], 7);
+        put(e1[c], 7);
+    }
+    put(1, 1); // p-bits
+    put(1, 1);
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        put((i % 4) * 3 + (i / 4) * 2, i == 0 ? 3 : 4);
+    }
+    memcpy(out, block, 16);
+}
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [bc]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    const FORMAT formats[2] = { FORMAT_BC1_RGBA_SRGB, FORMAT_BC7_SRGB };
+    const USAGE_FLAGS usage = static_cast<USAGE_FLAGS>(USAGE_SAMPLED | USAGE_TRANSFER_DST);
+    for (FORMAT format : formats)
+    {
+        if (!gpuFormatSupported(device, format, usage))
+        {
+            std::cout << "SKIP [bc]: device cannot sample BC1 and BC7\n";
+            gpuDestroyDevice(device);
+            test::endValidationCapture();
+            gpuDestroyInstance();
+            return 0;
+        }
+    }
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+    LinearAllocator<MEMORY_DESCRIPTOR> descriptorAllocator(device);
+
+    auto atlasIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/MipAtlas.spv");
+    auto pipeline = gpuCreateComputePipeline(device, ByteSpan(atlasIR.data(), atlasIR.size()));
+
+    auto textureHeap = descriptorAllocator.allocate<GpuTextureDescriptor>(1024);
+
+    const uint32_t size = 64;
+    const uint32_t blocks = size / 4;
+
+    GpuTexture textures[2] = {};
+    GpuTexture outputs[2] = {};
+    void* memory[4] = {};
+    auto commandBuffer = gpuStartCommandRecording(queue);
+    gpuSetPipeline(commandBuffer, pipeline);
+    gpuSetActiveTextureHeapPtr(commandBuffer, textureHeap.gpu);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        GpuTextureDesc textureDesc{
+            .type = TEXTURE_2D,
+            .dimensions = { size, size, 1 },
+            .format = formats[i],
+            .usage = usage
+        };
+        GpuTextureSizeAlign sizeAlign = gpuTextureSizeAlign(device, textureDesc);
+        memory[i * 2] = gpuMalloc(device, sizeAlign.size, MEMORY_GPU);
+        textures[i] = gpuCreateTexture(device, textureDesc, memory[i * 2]);
+
+        GpuTextureDesc outputDesc{
+            .type = TEXTURE_2D,
+            .dimensions = { size, size, 1 },
+            .format = FORMAT_RGBA8_UNORM,
+            .usage = static_cast<USAGE_FLAGS>(USAGE_STORAGE | USAGE_TRANSFER_SRC)
+        };
+        GpuTextureSizeAlign outputSizeAlign = gpuTextureSizeAlign(device, outputDesc);
+        memory[i * 2 + 1] = gpuMalloc(device, outputSizeAlign.size, MEMORY_GPU);
+        outputs[i] = gpuCreateTexture(device, outputDesc, memory[i * 2 + 1]);
+
+        // Blocks in row-major order, tightly packed.
+        const uint32_t blockBytes = gpuFormatBlock(formats[i]).bytes;
+        auto upload = allocator.allocate<uint8_t>(blocks * blocks * blockBytes);
+        for (uint32_t by = 0; by < blocks; by++)
+        {
+            for (uint32_t bx = 0; bx < blocks; bx++)
+            {
+                uint8_t* block = upload.cpu + (by * blocks + bx) * blockBytes;
+                if (i == 0)
+                {
+                    encodeBC1(block, bx, by);
+                }
+                else
+                {
+                    encodeBC7(block, bx, by);
+                }
+            }
+        }
+
+        textureHeap.cpu[i * 2] = gpuTextureViewDescriptor(textures[i], GpuViewDesc{ .format = formats[i] });
+        textureHeap.cpu[i * 2 + 1] = gpuRWTextureViewDescriptor(outputs[i], GpuViewDesc{ .format = FORMAT_RGBA8_UNORM });
+
+        auto data = allocator.allocate<MipAtlasData>(1);
+        data.cpu->atlasSize = { size, size };
+        data.cpu->mip0Size = { size, size };
+        data.cpu->srcTexture = i * 2;
+        data.cpu->dstTexture = i * 2 + 1;
+        data.cpu->mipCount = 1;
+
+        gpuCopyToTexture(commandBuffer, upload.gpu, textures[i]);
+        gpuBarrier(commandBuffer, STAGE_TRANSFER, STAGE_COMPUTE);
+        gpuDispatch(commandBuffer, data.gpu, { size / 16, size / 16, 1 });
+    }
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    // BC1 on the left, BC7 on the right.
+    test::Image actual;
+    actual.width = size * 2;
+    actual.height = size;
+    actual.rgba.resize(static_cast<size_t>(actual.width) * actual.height * 4);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        test::Image half = test::readbackRGBA8(device, queue, outputs[i], size, size);
+        for (uint32_t y = 0; y < size; y++)
+        {
+            memcpy(&actual.rgba[(y * actual.width + i * size) * 4], &half.rgba[y * size * 4], size * 4);
+        }
+    }
+    int rc = test::finalize(args, "bc", actual);
+
+    allocator.reset();
+    descriptorAllocator.reset();
+    gpuDestroySemaphore(semaphore);
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        gpuDestroyTexture(textures[i]);
+        gpuDestroyTexture(outputs[i]);
+    }
+    gpuFreePipeline(pipeline);
+    for (void* ptr : memory)
+    {
+        gpuFree(device, ptr);
+    }
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [bc]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}
@@ -62,24 +62,30 @@ namespace test
         return true;
     }
 
-    Image readbackRGBA8(GpuDevice device, GpuQueue queue, GpuTexture texture, uint32_t width, uint32_t height)
+    std::vector<uint8_t> readbackRegion(GpuDevice device, GpuQueue queue, GpuTexture texture, GpuTextureRegion region, size_t bytes)
     {
-        const size_t bytes = static_cast<size_t>(width) * height * 4;
         uint8_t* readback = static_cast<uint8_t*>(gpuMalloc(device, bytes, MEMORY_READBACK));
 
         auto semaphore = gpuCreateSemaphore(device, 0);
         auto cmd = gpuStartCommandRecording(queue);
-        gpuCopyFromTexture(cmd, gpuHostToDevicePointer(device, readback), texture);
+        GpuBufferTextureCopy copy = { .bufferGpu = gpuHostToDevicePointer(device, readback), .region = region };
+        gpuCopyFromTexture(cmd, texture, Span<GpuBufferTextureCopy>(&copy, 1));
         gpuSubmit(queue, Span<GpuCommandBuffer>(&cmd, 1), semaphore, 1);
         gpuWaitSemaphore(semaphore, 1);
 
-        Image img;
-        img.width = static_cast<int>(width);
-        img.height = static_cast<int>(height);
-        img.rgba.assign(readback, readback + bytes);
+        std::vector<uint8_t> data(readback, readback + bytes);
 
         gpuDestroySemaphore(semaphore);
         gpuFree(device, readback);
+        return data;
+    }
+
+    Image readbackRGBA8(GpuDevice device, GpuQueue queue, GpuTexture texture, uint32_t width, uint32_t height)
+    {
+        Image img;
+        img.width = static_cast<int>(width);
+        img.height = static_cast<int>(height);
+        img.rgba = readbackRegion(device, queue, texture, GpuTextureRegion{ .layerCount = 1 }, static_cast<size_t>(width) * height * 4);
         return img;
     }
 
@@ -142,11 +148,11 @@ namespace test
     }
 
     // ---- golden generation / comparison ------------------------------------
-    int finalize(const Args& args, const std::string& name, const Image& actual)
+    int finalize(const Args& args, const std::string& name, const Image& actual, const std::string& reference)
     {
-        const std::string goldenPath = std::string(NGAPI_TEST_REFERENCE_DIR) + "/" + name + ".png";
+        const std::string goldenPath = std::string(NGAPI_TEST_REFERENCE_DIR) + "/" + (reference.empty() ? name : reference) + ".png";
 
-        if (args.generate)
+        if (args.generate && reference.empty())
         {
             std::error_code ec;
             std::filesystem::create_directories(NGAPI_TEST_REFERENCE_DIR, ec);
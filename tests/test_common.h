@@ -44,13 +44,19 @@ namespace test
     void endValidationCapture();
     bool validationFailed();
 
-    // Copies an RGBA8_UNORM texture back to CPU memory (texture must allow TRANSFER_SRC).
+    // Copies one region of a texture back to CPU memory, tightly packed (stencil
+    // regions are 1 byte per texel). `bytes` is the packed size of the region.
+    std::vector<uint8_t> readbackRegion(GpuDevice device, GpuQueue queue, GpuTexture texture, GpuTextureRegion region, size_t bytes);
+
+    // Copies an RGBA8_UNORM texture (layer 0) back to CPU memory (texture must allow TRANSFER_SRC).
     Image readbackRGBA8(GpuDevice device, GpuQueue queue, GpuTexture texture, uint32_t width, uint32_t height);
 
     // Generate-or-compare against tests/reference/<name>.png. Returns a process exit
     // code: 0 = pass (or golden generated), non-zero = mismatch / missing golden / error.
     // On mismatch, writes <name>_actual.png and <name>_diff.png in the current directory.
-    int finalize(const Args& args, const std::string& name, const Image& actual);
+    // A variant of another test passes that test's golden as `reference`: it is compared
+    // against, and left alone by --generate.
+    int finalize(const Args& args, const std::string& name, const Image& actual, const std::string& reference = {});
 } // namespace test
 
 #endif // NGAPI_TEST_COMMON_H
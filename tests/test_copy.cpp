@@ -0,0 +1,180 @@
+// Headless test for region texture copies. Mip 1 of both layers of a 2-layer,
+// 3-mip array gets a known pattern in one batched gpuCopyToTexture; then a
+// 6x5 sub-rectangle goes into mip 1 of layer 1 from a buffer whose rows are
+// padded (rowPitch wider than the region). Readbacks of both layers' mip 1
+// and of the sub-rectangle alone are compared byte for byte on the CPU: the
+// rectangle must land at its offset, padding must not, and layer 0 and the
+// rest of layer 1 must keep the first pattern. No golden is involved.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [copy]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    const uint32_t mipSize = 16; // mip 1 of a 32x32 texture
+    const uint3 rectOffset = { 3, 7, 0 };
+    const uint3 rectExtent = { 6, 5, 1 };
+    const uint32_t rectPitchTexels = 8; // two texels of padding per row
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+
+    GpuTextureDesc textureDesc{
+        .type = TEXTURE_2D_ARRAY,
+        .dimensions = { 32, 32, 1 },
+        .mipCount = 3,
+        .layerCount = 2,
+        .format = FORMAT_RGBA8_UNORM,
+        .usage = static_cast<USAGE_FLAGS>(USAGE_TRANSFER_SRC | USAGE_TRANSFER_DST)
+    };
+    GpuTextureSizeAlign sizeAlign = gpuTextureSizeAlign(device, textureDesc);
+    void* texturePtr = gpuMalloc(device, sizeAlign.size, MEMORY_GPU);
+    auto texture = gpuCreateTexture(device, textureDesc, texturePtr);
+
+    // Background texel of mip 1: coordinates in red/green, layer in blue.
+    auto background = [](uint32_t x, uint32_t y, uint32_t layer, uint8_t* texel)
+    {
+        texel[0] = static_cast<uint8_t>(x * 8);
+        texel[1] = static_cast<uint8_t>(y * 8);
+        texel[2] = layer ? 0xa0 : 0x50;
+        texel[3] = 0xff;
+    };
+    // Sub-rectangle texel, by position inside the rectangle.
+    auto patch = [](uint32_t x, uint32_t y, uint8_t* texel)
+    {
+        texel[0] = static_cast<uint8_t>(0xc0 | x);
+        texel[1] = static_cast<uint8_t>(0x80 | y);
+        texel[2] = 0x33;
+        texel[3] = 0x77;
+    };
+
+    const uint32_t layerBytes = mipSize * mipSize * 4;
+    auto layers = allocator.allocate<uint8_t>(layerBytes * 2);
+    for (uint32_t layer = 0; layer < 2; layer++)
+    {
+        for (uint32_t y = 0; y < mipSize; y++)
+        {
+            for (uint32_t x = 0; x < mipSize; x++)
+            {
+                background(x, y, layer, layers.cpu + layer * layerBytes + (y * mipSize + x) * 4);
+            }
+        }
+    }
+
+    const uint32_t rectPitch = rectPitchTexels * 4;
+    auto rect = allocator.allocate<uint8_t>(rectPitch * rectExtent.y);
+    memset(rect.cpu, 0xee, rectPitch * rectExtent.y);
+    for (uint32_t y = 0; y < rectExtent.y; y++)
+    {
+        for (uint32_t x = 0; x < rectExtent.x; x++)
+        {
+            patch(x, y, rect.cpu + y * rectPitch + x * 4);
+        }
+    }
+
+    GpuBufferTextureCopy backgroundCopies[2] = {
+        { .bufferGpu = layers.gpu, .region = { .mip = 1, .baseLayer = 0, .layerCount = 1 } },
+        { .bufferGpu = static_cast<uint8_t*>(layers.gpu) + layerBytes, .region = { .mip = 1, .baseLayer = 1, .layerCount = 1 } },
+    };
+    GpuBufferTextureCopy rectCopy = {
+        .bufferGpu = rect.gpu,
+        .rowPitch = rectPitch,
+        .region = { .mip = 1, .baseLayer = 1, .layerCount = 1, .offset = rectOffset, .extent = rectExtent }
+    };
+
+    auto commandBuffer = gpuStartCommandRecording(queue);
+    gpuCopyToTexture(commandBuffer, texture, Span<GpuBufferTextureCopy>(backgroundCopies, 2));
+    gpuBarrier(commandBuffer, STAGE_TRANSFER, STAGE_TRANSFER);
+    gpuCopyToTexture(commandBuffer, texture, Span<GpuBufferTextureCopy>(&rectCopy, 1));
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    std::vector<uint8_t> mip1[2];
+    for (uint16_t layer = 0; layer < 2; layer++)
+    {
+        mip1[layer] = test::readbackRegion(device, queue, texture, GpuTextureRegion{ .mip = 1, .baseLayer = layer, .layerCount = 1 }, layerBytes);
+    }
+    std::vector<uint8_t> rectBack = test::readbackRegion(device, queue, texture, rectCopy.region, rectExtent.x * rectExtent.y * 4);
+
+    uint32_t mismatches[3] = {};
+    for (uint32_t layer = 0; layer < 2; layer++)
+    {
+        for (uint32_t y = 0; y < mipSize; y++)
+        {
+            for (uint32_t x = 0; x < mipSize; x++)
+            {
+                const bool inRect = layer == 1 && x >= rectOffset.x && x < rectOffset.x + rectExtent.x && y >= rectOffset.y && y < rectOffset.y + rectExtent.y;
+                uint8_t expected[4];
+                if (inRect)
+                {
+                    patch(x - rectOffset.x, y - rectOffset.y, expected);
+                }
+                else
+                {
+                    background(x, y, layer, expected);
+                }
+                if (memcmp(&mip1[layer][(y * mipSize + x) * 4], expected, 4) != 0)
+                {
+                    mismatches[layer]++;
+                }
+            }
+        }
+    }
+    for (uint32_t y = 0; y < rectExtent.y; y++)
+    {
+        for (uint32_t x = 0; x < rectExtent.x; x++)
+        {
+            uint8_t expected[4];
+            patch(x, y, expected);
+            if (memcmp(&rectBack[(y * rectExtent.x + x) * 4], expected, 4) != 0)
+            {
+                mismatches[2]++;
+            }
+        }
+    }
+
+    int rc = 0;
+    if (mismatches[0] || mismatches[1] || mismatches[2])
+    {
+        std::cerr << "FAIL [copy]: texels differ: " << mismatches[0] << " in layer 0 mip 1, " << mismatches[1] << " in layer 1 mip 1, "
+                  << mismatches[2] << " in the sub-rectangle readback\n";
+        rc = 1;
+    }
+    else
+    {
+        std::cout << "PASS [copy]\n";
+    }
+
+    allocator.reset();
+    gpuDestroySemaphore(semaphore);
+    gpuDestroyTexture(texture);
+    gpuFree(device, texturePtr);
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [copy]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}
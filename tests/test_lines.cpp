@@ -0,0 +1,169 @@
+// Headless test for line strips with primitive restart. A pipeline created
+// with TOPOLOGY_LINE_STRIP and primitiveRestart draws two strips from one
+// index buffer split by 0xFFFFFFFF (left): a red one near the top and a green
+// one near the bottom. As a control, the same vertices go through the same
+// pipeline with gpuSetPrimitiveRestart(false) and no restart index (right),
+// which joins the strips with a segment across the middle. Both halves are
+// compared to a golden; the middle rows must also be empty on the left only.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator, loadIR
+#include "Raster.h"    // RasterVertexData, RasterPixelData
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [lines]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    const uint32_t size = 64;
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+
+    auto makeTexture = [&](GpuTextureDesc desc, void** ptrOut)
+    {
+        GpuTextureSizeAlign sa = gpuTextureSizeAlign(device, desc);
+        *ptrOut = gpuMalloc(device, sa.size, MEMORY_GPU);
+        return gpuCreateTexture(device, desc, *ptrOut);
+    };
+
+    const GpuTextureDesc colorDesc = { .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .format = FORMAT_RGBA8_UNORM, .usage = (USAGE_FLAGS)(USAGE_COLOR_ATTACHMENT | USAGE_TRANSFER_SRC) };
+    void* restartPtr;
+    auto restartTarget = makeTexture(colorDesc, &restartPtr);
+    void* joinedPtr;
+    auto joinedTarget = makeTexture(colorDesc, &joinedPtr);
+
+    ColorTarget colorTarget = { .format = FORMAT_RGBA8_UNORM };
+    GpuRasterDesc rasterDesc = {
+        .topology = TOPOLOGY_LINE_STRIP,
+        .primitiveRestart = true,
+        .colorTargets = Span<ColorTarget>(&colorTarget, 1)
+    };
+    auto vertexIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterVertex.spv");
+    auto pixelIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterPixel.spv");
+    auto pipeline = gpuCreateGraphicsPipeline(device, ByteSpan(vertexIR), ByteSpan(pixelIR), rasterDesc);
+
+    // Vertices on pixel centers: strip 0-2 runs along row 16 and down to row
+    // 24, strip 3-4 runs along row 48. Joined, 2-3 crosses rows 25-47.
+    auto center = [](uint32_t x, uint32_t y) { return float4{ (x + 0.5f) / (size / 2) - 1.0f, (y + 0.5f) / (size / 2) - 1.0f, 0.5f, 1.0f }; };
+    const float4 positions[5] = { center(8, 16), center(56, 16), center(56, 24), center(8, 48), center(56, 48) };
+    const float4 colors[5] = {
+        { 1.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f },
+        { 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f }
+    };
+    const uint32_t restartIndices[6] = { 0, 1, 2, 0xFFFFFFFF, 3, 4 };
+    const uint32_t joinedIndices[5] = { 0, 1, 2, 3, 4 };
+    auto vertexPositions = allocator.allocate<float4>(5);
+    memcpy(vertexPositions.cpu, positions, sizeof(positions));
+    auto vertexColors = allocator.allocate<float4>(5);
+    memcpy(vertexColors.cpu, colors, sizeof(colors));
+    auto restart = allocator.allocate<uint32_t>(6);
+    memcpy(restart.cpu, restartIndices, sizeof(restartIndices));
+    auto joined = allocator.allocate<uint32_t>(5);
+    memcpy(joined.cpu, joinedIndices, sizeof(joinedIndices));
+
+    auto vertexData = allocator.allocate<RasterVertexData>(1);
+    vertexData.cpu->positions = vertexPositions.gpu;
+    vertexData.cpu->colors = vertexColors.gpu;
+    auto pixelData = allocator.allocate<RasterPixelData>(1);
+    pixelData.cpu->tint = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    auto commandBuffer = gpuStartCommandRecording(queue);
+    gpuSetPipeline(commandBuffer, pipeline);
+
+    GpuRenderPassDesc restartPass = { .colorTargets = Span<GpuTexture>(&restartTarget, 1) };
+    gpuBeginRenderPass(commandBuffer, restartPass);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, restart.gpu, 6, 1);
+    gpuEndRenderPass(commandBuffer);
+
+    GpuRenderPassDesc joinedPass = { .colorTargets = Span<GpuTexture>(&joinedTarget, 1) };
+    gpuBeginRenderPass(commandBuffer, joinedPass);
+    gpuSetPrimitiveRestart(commandBuffer, false);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, joined.gpu, 5, 1);
+    gpuEndRenderPass(commandBuffer);
+
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    test::Image restartImage = test::readbackRGBA8(device, queue, restartTarget, size, size);
+    test::Image joinedImage = test::readbackRGBA8(device, queue, joinedTarget, size, size);
+
+    // Restarted strips on the left, the joined control on the right.
+    test::Image actual;
+    actual.width = size * 2;
+    actual.height = size;
+    actual.rgba.resize(static_cast<size_t>(actual.width) * actual.height * 4);
+    for (uint32_t y = 0; y < size; y++)
+    {
+        memcpy(&actual.rgba[y * actual.width * 4], &restartImage.rgba[y * size * 4], size * 4);
+        memcpy(&actual.rgba[(y * actual.width + size) * 4], &joinedImage.rgba[y * size * 4], size * 4);
+    }
+    int rc = test::finalize(args, "lines", actual);
+
+    // Lit pixels strictly between the strips: only the joining segment's.
+    auto litBetweenStrips = [](const test::Image& image)
+    {
+        uint32_t lit = 0;
+        for (uint32_t y = 28; y < 44; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const uint8_t* pixel = &image.rgba[(y * size + x) * 4];
+                if (pixel[0] != 0 || pixel[1] != 0 || pixel[2] != 0)
+                {
+                    lit++;
+                }
+            }
+        }
+        return lit;
+    };
+    auto lit = [&](const test::Image& image, uint32_t x, uint32_t y) { return image.rgba[(y * size + x) * 4] != 0 || image.rgba[(y * size + x) * 4 + 1] != 0; };
+    if (!lit(restartImage, 32, 16) || !lit(restartImage, 32, 48))
+    {
+        std::cerr << "FAIL [lines]: a restarted strip is missing\n";
+        rc = 1;
+    }
+    if (const uint32_t stray = litBetweenStrips(restartImage); stray > 0)
+    {
+        std::cerr << "FAIL [lines]: " << stray << " pixels between the strips are lit; the restart index joined them\n";
+        rc = 1;
+    }
+    if (litBetweenStrips(joinedImage) == 0)
+    {
+        std::cerr << "FAIL [lines]: the control draw without restart did not join the strips\n";
+        rc = 1;
+    }
+
+    allocator.reset();
+    gpuDestroySemaphore(semaphore);
+    gpuDestroyTexture(restartTarget);
+    gpuFree(device, restartPtr);
+    gpuDestroyTexture(joinedTarget);
+    gpuFree(device, joinedPtr);
+    gpuFreePipeline(pipeline);
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [lines]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,137 @@
+// Headless test for gpuGenerateMips: upload a non-power-of-two sRGB crop of the
+// default image, build its full mip chain on the GPU, then lay every level out
+// in one atlas with a compute pass and compare the atlas to a golden.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator, loadIR
+#include "MipAtlas.h"  // MipAtlasData
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [mips]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    if (!gpuGenerateMipsSupported(device, FORMAT_RGBA8_SRGB))
+    {
+        std::cout << "SKIP [mips]: device cannot blit RGBA8_SRGB\n";
+        gpuDestroyDevice(device);
+        test::endValidationCapture();
+        gpuDestroyInstance();
+        return 0;
+    }
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+    LinearAllocator<MEMORY_DESCRIPTOR> descriptorAllocator(device);
+
+    auto atlasIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/MipAtlas.spv");
+    auto pipeline = gpuCreateComputePipeline(device, ByteSpan(atlasIR.data(), atlasIR.size()));
+
+    auto textureHeap = descriptorAllocator.allocate<GpuTextureDescriptor>(1024);
+
+    int imageWidth, imageHeight, channels;
+    const std::string inputPath = std::string(NGAPI_TEST_ASSET_DIR) + "/Default.png";
+    stbi_uc* inputImage = stbi_load(inputPath.c_str(), &imageWidth, &imageHeight, &channels, 4);
+    if (!inputImage)
+    {
+        std::cerr << "FAIL [mips]: could not load " << inputPath << "\n";
+        return 1;
+    }
+
+    // Odd, non-power-of-two crop so the chain hits both even and odd halvings
+    // (200x120 -> 100x60 -> 50x30 -> 25x15 -> 12x7 -> 6x3 -> 3x1 -> 1x1).
+    const uint32_t width = std::min(200, imageWidth);
+    const uint32_t height = std::min(120, imageHeight);
+    const uint32_t mipCount = 8;
+
+    auto upload = allocator.allocate<uint8_t>(width * height * 4);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        memcpy(upload.cpu + y * width * 4, inputImage + y * imageWidth * 4, width * 4);
+    }
+
+    GpuTextureDesc textureDesc{
+        .type = TEXTURE_2D,
+        .dimensions = { width, height, 1 },
+        .mipCount = mipCount,
+        .format = FORMAT_RGBA8_SRGB,
+        .usage = static_cast<USAGE_FLAGS>(USAGE_SAMPLED | USAGE_TRANSFER_SRC | USAGE_TRANSFER_DST)
+    };
+    GpuTextureSizeAlign sizeAlign = gpuTextureSizeAlign(device, textureDesc);
+    void* texturePtr = gpuMalloc(device, sizeAlign.size, MEMORY_GPU);
+    auto texture = gpuCreateTexture(device, textureDesc, texturePtr);
+
+    // Mip 0 on the left, the remaining levels in a column to its right.
+    const uint32_t atlasWidth = width + width / 2;
+    const uint32_t atlasHeight = height;
+    GpuTextureDesc atlasDesc{
+        .type = TEXTURE_2D,
+        .dimensions = { atlasWidth, atlasHeight, 1 },
+        .format = FORMAT_RGBA8_UNORM,
+        .usage = static_cast<USAGE_FLAGS>(USAGE_STORAGE | USAGE_TRANSFER_SRC)
+    };
+    GpuTextureSizeAlign atlasSizeAlign = gpuTextureSizeAlign(device, atlasDesc);
+    void* atlasPtr = gpuMalloc(device, atlasSizeAlign.size, MEMORY_GPU);
+    auto atlas = gpuCreateTexture(device, atlasDesc, atlasPtr);
+
+    textureHeap.cpu[0] = gpuTextureViewDescriptor(texture, GpuViewDesc{ .format = FORMAT_RGBA8_SRGB });
+    textureHeap.cpu[1] = gpuRWTextureViewDescriptor(atlas, GpuViewDesc{ .format = FORMAT_RGBA8_UNORM });
+
+    auto data = allocator.allocate<MipAtlasData>(1);
+    data.cpu->atlasSize = { atlasWidth, atlasHeight };
+    data.cpu->mip0Size = { width, height };
+    data.cpu->srcTexture = 0;
+    data.cpu->dstTexture = 1;
+    data.cpu->mipCount = mipCount;
+
+    auto commandBuffer = gpuStartCommandRecording(queue);
+    gpuCopyToTexture(commandBuffer, upload.gpu, texture);
+    gpuGenerateMips(commandBuffer, texture);
+    gpuBarrier(commandBuffer, STAGE_TRANSFER, STAGE_COMPUTE);
+    gpuSetPipeline(commandBuffer, pipeline);
+    gpuSetActiveTextureHeapPtr(commandBuffer, textureHeap.gpu);
+    gpuDispatch(commandBuffer, data.gpu, { (atlasWidth + 15) / 16, (atlasHeight + 15) / 16, 1 });
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    test::Image actual = test::readbackRGBA8(device, queue, atlas, atlasWidth, atlasHeight);
+    int rc = test::finalize(args, "mips", actual);
+
+    stbi_image_free(inputImage);
+    allocator.reset();
+    descriptorAllocator.reset();
+    gpuDestroySemaphore(semaphore);
+    gpuDestroyTexture(texture);
+    gpuDestroyTexture(atlas);
+    gpuFreePipeline(pipeline);
+    gpuFree(device, texturePtr);
+    gpuFree(device, atlasPtr);
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [mips]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}
@@ -0,0 +1,155 @@
+// Headless test for multisample resolves: two overlapping triangles at
+// different depths go into 4x color and depth targets that are
+// USAGE_TRANSIENT (null ptrGpu, so they take the lazily allocated memory
+// path) and resolve at the end of the pass into single-sample targets. The
+// color resolve (left) and the depth resolve as grey (right) are compared
+// side by side to a golden.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator, loadIR
+#include "Raster.h"    // RasterVertexData, RasterPixelData
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [msaa]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    const uint32_t size = 64;
+    const uint8_t samples = 4;
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+
+    auto makeTexture = [&](GpuTextureDesc desc, void** ptrOut)
+    {
+        GpuTextureSizeAlign sa = gpuTextureSizeAlign(device, desc);
+        *ptrOut = gpuMalloc(device, sa.size, MEMORY_GPU);
+        return gpuCreateTexture(device, desc, *ptrOut);
+    };
+
+    // Multisampled targets never leave the pass: no memory of their own.
+    GpuTextureDesc msColorDesc{ .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .sampleCount = samples, .format = FORMAT_RGBA8_UNORM, .usage = (USAGE_FLAGS)(USAGE_COLOR_ATTACHMENT | USAGE_TRANSIENT) };
+    auto msColor = gpuCreateTexture(device, msColorDesc, nullptr);
+    GpuTextureDesc msDepthDesc{ .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .sampleCount = samples, .format = FORMAT_D32_FLOAT, .usage = (USAGE_FLAGS)(USAGE_DEPTH_STENCIL_ATTACHMENT | USAGE_TRANSIENT) };
+    auto msDepth = gpuCreateTexture(device, msDepthDesc, nullptr);
+    if (!msColor || !msDepth)
+    {
+        std::cerr << "FAIL [msaa]: could not create the transient multisampled targets\n";
+        return 1;
+    }
+
+    void* colorPtr;
+    auto color = makeTexture({ .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .format = FORMAT_RGBA8_UNORM, .usage = (USAGE_FLAGS)(USAGE_COLOR_ATTACHMENT | USAGE_TRANSFER_SRC) }, &colorPtr);
+    void* depthPtr;
+    auto depth = makeTexture({ .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .format = FORMAT_D32_FLOAT, .usage = (USAGE_FLAGS)(USAGE_DEPTH_STENCIL_ATTACHMENT | USAGE_TRANSFER_SRC) }, &depthPtr);
+
+    ColorTarget colorTarget = { .format = FORMAT_RGBA8_UNORM };
+    GpuRasterDesc rasterDesc = {
+        .sampleCount = samples,
+        .depthFormat = FORMAT_D32_FLOAT,
+        .colorTargets = Span<ColorTarget>(&colorTarget, 1)
+    };
+    auto vertexIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterVertex.spv");
+    auto pixelIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterPixel.spv");
+    auto pipeline = gpuCreateGraphicsPipeline(device, ByteSpan(vertexIR), ByteSpan(pixelIR), rasterDesc);
+
+    auto depthState = gpuCreateDepthStencilState({ .depthMode = (DEPTH_FLAGS)(DEPTH_READ | DEPTH_WRITE), .depthTest = OP_LESS });
+
+    // A red triangle behind a nearer green one; no edge is axis aligned, so
+    // every edge leaves partially covered pixels for the resolve to average.
+    const float4 positions[6] = {
+        { -0.8f, -0.7f, 0.6f, 1.0f }, { 0.9f, -0.2f, 0.6f, 1.0f }, { -0.3f, 0.85f, 0.6f, 1.0f },
+        { -0.2f, -0.9f, 0.3f, 1.0f }, { 0.7f, 0.8f, 0.3f, 1.0f }, { -0.9f, 0.3f, 0.3f, 1.0f }
+    };
+    const float4 colors[6] = {
+        { 1.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 1.0f },
+        { 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f }
+    };
+    auto vertexPositions = allocator.allocate<float4>(6);
+    memcpy(vertexPositions.cpu, positions, sizeof(positions));
+    auto vertexColors = allocator.allocate<float4>(6);
+    memcpy(vertexColors.cpu, colors, sizeof(colors));
+    auto indices = allocator.allocate<uint32_t>(6);
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        indices.cpu[i] = i;
+    }
+
+    auto vertexData = allocator.allocate<RasterVertexData>(1);
+    vertexData.cpu->positions = vertexPositions.gpu;
+    vertexData.cpu->colors = vertexColors.gpu;
+    auto pixelData = allocator.allocate<RasterPixelData>(1);
+    pixelData.cpu->tint = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    auto commandBuffer = gpuStartCommandRecording(queue);
+    GpuRenderPassDesc renderPassDesc = {
+        .colorTargets = Span<GpuTexture>(&msColor, 1),
+        .depthStencilTarget = msDepth,
+        .resolveTargets = Span<GpuTexture>(&color, 1),
+        .depthStencilResolveTarget = depth
+    };
+    gpuSetPipeline(commandBuffer, pipeline);
+    gpuBeginRenderPass(commandBuffer, renderPassDesc);
+    gpuSetDepthStencilState(commandBuffer, depthState);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, indices.gpu, 6, 1);
+    gpuEndRenderPass(commandBuffer);
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    // Color resolve on the left, depth resolve (SAMPLE_ZERO) as grey on the right.
+    test::Image actual;
+    actual.width = size * 2;
+    actual.height = size;
+    actual.rgba.resize(static_cast<size_t>(actual.width) * actual.height * 4);
+    test::Image resolved = test::readbackRGBA8(device, queue, color, size, size);
+    std::vector<uint8_t> depthBytes = test::readbackRegion(device, queue, depth, GpuTextureRegion{}, size * size * sizeof(float));
+    for (uint32_t y = 0; y < size; y++)
+    {
+        memcpy(&actual.rgba[y * actual.width * 4], &resolved.rgba[y * size * 4], size * 4);
+        for (uint32_t x = 0; x < size; x++)
+        {
+            float d;
+            memcpy(&d, &depthBytes[(y * size + x) * sizeof(float)], sizeof(float));
+            uint8_t* pixel = &actual.rgba[(y * actual.width + size + x) * 4];
+            pixel[0] = pixel[1] = pixel[2] = static_cast<uint8_t>(d * 255.0f + 0.5f);
+            pixel[3] = 255;
+        }
+    }
+    int rc = test::finalize(args, "msaa", actual);
+
+    allocator.reset();
+    gpuDestroySemaphore(semaphore);
+    gpuDestroyTexture(msColor);
+    gpuDestroyTexture(msDepth);
+    gpuDestroyTexture(color);
+    gpuFree(device, colorPtr);
+    gpuDestroyTexture(depth);
+    gpuFree(device, depthPtr);
+    gpuFreePipeline(pipeline);
+    gpuFreeDepthStencilState(depthState);
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [msaa]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}
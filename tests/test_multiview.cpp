@@ -0,0 +1,190 @@
+// Headless test for multiview passes: one draw with viewMask 0b11 renders a
+// triangle into both layers of a 2-layer color array, each view shifted by
+// its own SV_ViewID offset. A depth-only multiview pass does the same into a
+// smaller 2-layer depth array, so its render area must come from the depth
+// target. Each layer's color (left) and depth as grey (right) are compared to
+// a golden, one row per layer; layer 1 must also be layer 0 moved by the
+// offset difference. Skipped on devices without two-view multiview.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator, loadIR
+#include "Raster.h"    // RasterMultiviewData, RasterPixelData
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [multiview]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    if (gpuMaxViewCount(device) < 2)
+    {
+        std::cout << "SKIP [multiview]: device cannot render two views in one pass\n";
+        gpuDestroyDevice(device);
+        test::endValidationCapture();
+        gpuDestroyInstance();
+        return 0;
+    }
+
+    const uint32_t colorSize = 64;
+    const uint32_t depthSize = 48;
+    const uint32_t viewMask = 0b11;
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+
+    auto makeTexture = [&](GpuTextureDesc desc, void** ptrOut)
+    {
+        GpuTextureSizeAlign sa = gpuTextureSizeAlign(device, desc);
+        *ptrOut = gpuMalloc(device, sa.size, MEMORY_GPU);
+        return gpuCreateTexture(device, desc, *ptrOut);
+    };
+
+    void* colorPtr;
+    auto color = makeTexture({ .type = TEXTURE_2D_ARRAY, .dimensions = { colorSize, colorSize, 1 }, .layerCount = 2, .format = FORMAT_RGBA8_UNORM, .usage = (USAGE_FLAGS)(USAGE_COLOR_ATTACHMENT | USAGE_TRANSFER_SRC) }, &colorPtr);
+    void* depthPtr;
+    auto depth = makeTexture({ .type = TEXTURE_2D_ARRAY, .dimensions = { depthSize, depthSize, 1 }, .layerCount = 2, .format = FORMAT_D32_FLOAT, .usage = (USAGE_FLAGS)(USAGE_DEPTH_STENCIL_ATTACHMENT | USAGE_TRANSFER_SRC) }, &depthPtr);
+
+    auto vertexIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterMultiview.spv");
+    auto pixelIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterPixel.spv");
+    auto depthPixelIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterDepthPixel.spv");
+
+    ColorTarget colorTarget = { .format = FORMAT_RGBA8_UNORM };
+    GpuRasterDesc colorRaster = { .viewMask = viewMask, .colorTargets = Span<ColorTarget>(&colorTarget, 1) };
+    auto colorPipeline = gpuCreateGraphicsPipeline(device, ByteSpan(vertexIR), ByteSpan(pixelIR), colorRaster);
+    GpuRasterDesc depthRaster = { .depthFormat = FORMAT_D32_FLOAT, .viewMask = viewMask };
+    auto depthPipeline = gpuCreateGraphicsPipeline(device, ByteSpan(vertexIR), ByteSpan(depthPixelIR), depthRaster);
+    auto depthState = gpuCreateDepthStencilState({ .depthMode = (DEPTH_FLAGS)(DEPTH_READ | DEPTH_WRITE), .depthTest = OP_LESS });
+
+    // One triangle with a color and a depth gradient, inside clip x [-0.6, 0.6]
+    // so both views' copies (shifted by -0.25 and +0.25) stay on screen.
+    const float4 positions[3] = { { -0.6f, -0.7f, 0.2f, 1.0f }, { 0.6f, -0.3f, 0.5f, 1.0f }, { -0.1f, 0.75f, 0.8f, 1.0f } };
+    const float4 colors[3] = { { 1.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 1.0f } };
+    auto vertexPositions = allocator.allocate<float4>(3);
+    memcpy(vertexPositions.cpu, positions, sizeof(positions));
+    auto vertexColors = allocator.allocate<float4>(3);
+    memcpy(vertexColors.cpu, colors, sizeof(colors));
+    auto indices = allocator.allocate<uint32_t>(3);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        indices.cpu[i] = i;
+    }
+
+    auto vertexData = allocator.allocate<RasterMultiviewData>(1);
+    vertexData.cpu->positions = vertexPositions.gpu;
+    vertexData.cpu->colors = vertexColors.gpu;
+    vertexData.cpu->viewOffsets = { -0.25f, 0.25f, 0.0f, 0.0f };
+    auto pixelData = allocator.allocate<RasterPixelData>(1);
+    pixelData.cpu->tint = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    auto commandBuffer = gpuStartCommandRecording(queue);
+
+    GpuRenderPassDesc colorPass = { .colorTargets = Span<GpuTexture>(&color, 1), .viewMask = viewMask };
+    gpuSetPipeline(commandBuffer, colorPipeline);
+    gpuBeginRenderPass(commandBuffer, colorPass);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, indices.gpu, 3, 1);
+    gpuEndRenderPass(commandBuffer);
+
+    // No color targets: the render area is the 48x48 depth target's.
+    GpuRenderPassDesc depthPass = { .depthStencilTarget = depth, .viewMask = viewMask };
+    gpuSetPipeline(commandBuffer, depthPipeline);
+    gpuBeginRenderPass(commandBuffer, depthPass);
+    gpuSetDepthStencilState(commandBuffer, depthState);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, indices.gpu, 3, 1);
+    gpuEndRenderPass(commandBuffer);
+
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    std::vector<uint8_t> colorLayers[2];
+    std::vector<uint8_t> depthLayers[2];
+    for (uint16_t layer = 0; layer < 2; layer++)
+    {
+        colorLayers[layer] = test::readbackRegion(device, queue, color, GpuTextureRegion{ .baseLayer = layer, .layerCount = 1 }, colorSize * colorSize * 4);
+        depthLayers[layer] = test::readbackRegion(device, queue, depth, GpuTextureRegion{ .baseLayer = layer, .layerCount = 1 }, depthSize * depthSize * sizeof(float));
+    }
+
+    // Row per layer: color on the left, depth as grey on the right.
+    test::Image actual;
+    actual.width = colorSize + depthSize;
+    actual.height = colorSize * 2;
+    actual.rgba.assign(static_cast<size_t>(actual.width) * actual.height * 4, 0);
+    for (uint32_t layer = 0; layer < 2; layer++)
+    {
+        for (uint32_t y = 0; y < colorSize; y++)
+        {
+            memcpy(&actual.rgba[((layer * colorSize + y) * actual.width) * 4], &colorLayers[layer][y * colorSize * 4], colorSize * 4);
+        }
+        for (uint32_t y = 0; y < depthSize; y++)
+        {
+            for (uint32_t x = 0; x < depthSize; x++)
+            {
+                float d;
+                memcpy(&d, &depthLayers[layer][(y * depthSize + x) * sizeof(float)], sizeof(float));
+                uint8_t* pixel = &actual.rgba[((layer * colorSize + y) * actual.width + colorSize + x) * 4];
+                pixel[0] = pixel[1] = pixel[2] = static_cast<uint8_t>(d * 255.0f + 0.5f);
+                pixel[3] = 255;
+            }
+        }
+    }
+    int rc = test::finalize(args, "multiview", actual);
+
+    // The views differ by 0.5 in clip x: a quarter of each target's width,
+    // a whole number of pixels, so layer 1 is exactly layer 0 moved right.
+    auto shiftMismatches = [](const std::vector<uint8_t>* layers, uint32_t size, uint32_t texelBytes)
+    {
+        const uint32_t shift = size / 4;
+        uint32_t mismatches = 0;
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x + shift < size; x++)
+            {
+                if (memcmp(&layers[0][(y * size + x) * texelBytes], &layers[1][(y * size + x + shift) * texelBytes], texelBytes) != 0)
+                {
+                    mismatches++;
+                }
+            }
+        }
+        return mismatches;
+    };
+    const uint32_t colorMismatches = shiftMismatches(colorLayers, colorSize, 4);
+    const uint32_t depthMismatches = shiftMismatches(depthLayers, depthSize, sizeof(float));
+    if (colorMismatches > 0 || depthMismatches > 0)
+    {
+        std::cerr << "FAIL [multiview]: layer 1 is not layer 0 shifted (" << colorMismatches << " color, " << depthMismatches << " depth texels differ)\n";
+        rc = 1;
+    }
+
+    allocator.reset();
+    gpuDestroySemaphore(semaphore);
+    gpuDestroyTexture(color);
+    gpuFree(device, colorPtr);
+    gpuDestroyTexture(depth);
+    gpuFree(device, depthPtr);
+    gpuFreePipeline(colorPipeline);
+    gpuFreePipeline(depthPipeline);
+    gpuFreeDepthStencilState(depthState);
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [multiview]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}
@@ -3,10 +3,19 @@
 // of ray-queried direct lighting, and blits the float output into an RGBA8 capture
 // texture that is read back and compared to a golden. Deterministic: fixed RNG
 // seeds, static camera, no wall-clock.
+//
+// Built a second time as test_raytracing_indirect (TEST_INDIRECT_TLAS): a
+// compute pass writes the TLAS instances, a few inactive spare slots and the
+// build range, and the TLAS is built and updated with
+// gpuBuildAccelerationStructuresIndirect. The image must match the same golden
+// whether the indirect build or its direct fallback ran (NGAPI_NO_INDIRECT_AS_BUILD).
 #include "test_common.h"
 
 #include "Utilities.h"  // LinearAllocator, loadIR, getCube, haltonSequence
 #include "Raytracing.h" // RaytracingData, CameraData, LightData, PrimitiveData, MeshData, Sample
+#ifdef TEST_INDIRECT_TLAS
+#include "TlasInstances.h" // TlasInstancesData
+#endif
 
 #include "stb_image.h"
 
@@ -22,6 +31,14 @@
 #include <string>
 #include <vector>
 
+#ifdef TEST_INDIRECT_TLAS
+static const char* const TEST_NAME = "raytracing_indirect";
+static const char* const TEST_REFERENCE = "raytracing"; // compared against, never regenerated
+#else
+static const char* const TEST_NAME = "raytracing";
+static const char* const TEST_REFERENCE = "";
+#endif
+
 int main(int argc, char** argv)
 {
     test::Args args = test::parseArgs(argc, argv);
@@ -32,7 +49,7 @@ int main(int argc, char** argv)
     auto device = gpuCreateDevice(args.device);
     if (!device)
     {
-        std::cerr << "FAIL [raytracing]: no suitable device at index " << args.device << "\n";
+        std::cerr << "FAIL [" << TEST_NAME << "]: no suitable device at index " << args.device << "\n";
         return 1;
     }
 
@@ -49,7 +66,7 @@ int main(int argc, char** argv)
     stbi_uc* inputImage = stbi_load(inputPath.c_str(), &width, &height, &channels, 4);
     if (!inputImage)
     {
-        std::cerr << "FAIL [raytracing]: could not load " << inputPath << "\n";
+        std::cerr << "FAIL [" << TEST_NAME << "]: could not load " << inputPath << "\n";
         return 1;
     }
     auto upload = allocator.allocate<uint8_t>(width * height * 4);
@@ -188,6 +205,8 @@ int main(int argc, char** argv)
     void* blasPtr = gpuMalloc(device, blasSize.size, MEMORY_GPU);
     auto blas = gpuCreateAccelerationStructure(device, blasASDesc, blasPtr, blasSize.size);
 
+    // Indirect: these are the source the compute pass copies from; the TLAS
+    // reads tlasInstances, cubeCount live slots and tlasSpare inactive ones.
     auto instances = allocator.allocate<GpuAccelerationStructureInstanceDesc>(cubeCount);
     const float scale = 0.5f;
     {
@@ -206,21 +225,48 @@ int main(int argc, char** argv)
             instances.cpu[i].instanceMask = 0xFF;
             instances.cpu[i].hitGroupIndex = 0;
             instances.cpu[i].flags = 0;
-            instances.cpu[i].blasAddress = blasPtr;
+            instances.cpu[i].blasAddress = gpuAccelerationStructureAddress(blas);
         }
     }
 
+#ifdef TEST_INDIRECT_TLAS
+    const uint32_t tlasSpare = 4;
+    const uint32_t tlasCapacity = cubeCount + tlasSpare;
+    void* tlasInstances = gpuMalloc(device, tlasCapacity * sizeof(GpuAccelerationStructureInstanceDesc), MEMORY_GPU);
+    void* tlasRange = gpuMalloc(device, sizeof(GpuAccelerationStructureBuildRange), MEMORY_GPU);
+
+    auto instancesIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/TlasInstances.spv");
+    auto instancesPipeline = gpuCreateComputePipeline(device, ByteSpan(instancesIR));
+
+    auto instancesData = allocator.allocate<TlasInstancesData>(1);
+    instancesData.cpu->source = instances.gpu;
+    instancesData.cpu->instances = static_cast<GpuAccelerationStructureInstanceDesc*>(tlasInstances);
+    instancesData.cpu->range = static_cast<uint*>(tlasRange);
+    instancesData.cpu->blasAddress = gpuAccelerationStructureAddress(blas);
+    instancesData.cpu->count = cubeCount;
+    instancesData.cpu->capacity = tlasCapacity;
+
+    // The creation range is the upper bound; the build reads the live count.
+    GpuAccelerationStructureBuildRange tlasBuildRange = { .primitiveCount = tlasCapacity };
+    void* tlasInstancesGpu = tlasInstances;
+#else
     GpuAccelerationStructureBuildRange tlasBuildRange = { .primitiveCount = cubeCount };
+    void* tlasInstancesGpu = instances.gpu;
+#endif
     GpuAccelerationStructureDesc tlasDesc = {
         .type = TYPE_TOP_LEVEL,
-        .tlasDesc = { .arrayOfPointers = false, .instancesGpu = instances.gpu },
+        .tlasDesc = { .arrayOfPointers = false, .instancesGpu = tlasInstancesGpu },
         .buildRanges = Span<GpuAccelerationStructureBuildRange>(&tlasBuildRange, 1)
     };
     auto tlasSize = gpuAccelerationStructureSizes(device, tlasDesc);
     void* tlasPtr = gpuMalloc(device, tlasSize.size, MEMORY_GPU);
     auto tlas = gpuCreateAccelerationStructure(device, tlasDesc, tlasPtr, tlasSize.size);
 
-    size_t scratchSize = std::max(blasSize.buildScratchSize, tlasSize.buildScratchSize);
+    // BLAS and TLAS are built in separate batches (the TLAS reads the BLAS),
+    // so one scratch range sized for the larger batch serves both.
+    size_t scratchSize = std::max(
+        gpuAccelerationStructureScratchSize(Span<GpuAccelerationStructure>(&blas, 1), MODE_BUILD),
+        gpuAccelerationStructureScratchSize(Span<GpuAccelerationStructure>(&tlas, 1), MODE_BUILD));
     void* scratchPtr = gpuMalloc(device, scratchSize, MEMORY_GPU);
 
     void* pixelSample = gpuMalloc(device, sizeof(Sample) * RENDER_W * RENDER_H, MEMORY_GPU);
@@ -276,15 +322,21 @@ int main(int argc, char** argv)
             gpuBarrier(commandBuffer, STAGE_TRANSFER, STAGE_COMPUTE, HAZARD_DESCRIPTORS);
             gpuBuildAccelerationStructures(commandBuffer, Span<GpuAccelerationStructure>(&blas, 1), scratchPtr, MODE_BUILD);
             gpuBarrier(commandBuffer, STAGE_ACCELERATION_STRUCTURE_BUILD, STAGE_ACCELERATION_STRUCTURE_BUILD, HAZARD_ACCELERATION_STRUCTURE);
-            gpuBuildAccelerationStructures(commandBuffer, Span<GpuAccelerationStructure>(&tlas, 1), scratchPtr, MODE_BUILD);
-            gpuBarrier(commandBuffer, STAGE_ACCELERATION_STRUCTURE_BUILD, STAGE_COMPUTE, HAZARD_ACCELERATION_STRUCTURE);
-        }
-        else
-        {
-            gpuBuildAccelerationStructures(commandBuffer, Span<GpuAccelerationStructure>(&tlas, 1), scratchPtr, MODE_UPDATE);
-            gpuBarrier(commandBuffer, STAGE_ACCELERATION_STRUCTURE_BUILD, STAGE_COMPUTE, HAZARD_ACCELERATION_STRUCTURE);
         }
 
+        const MODE tlasMode = nextFrame == 1 ? MODE_BUILD : MODE_UPDATE;
+#ifdef TEST_INDIRECT_TLAS
+        // Rewritten every frame like a GPU-driven scene; an update must see
+        // the same count as the build, which the range keeps.
+        gpuSetPipeline(commandBuffer, instancesPipeline);
+        gpuDispatch(commandBuffer, instancesData.gpu, { (tlasCapacity + 63) / 64, 1, 1 });
+        gpuBarrier(commandBuffer, STAGE_COMPUTE, STAGE_ACCELERATION_STRUCTURE_BUILD);
+        gpuBuildAccelerationStructuresIndirect(commandBuffer, Span<GpuAccelerationStructure>(&tlas, 1), scratchPtr, tlasRange, tlasMode);
+#else
+        gpuBuildAccelerationStructures(commandBuffer, Span<GpuAccelerationStructure>(&tlas, 1), scratchPtr, tlasMode);
+#endif
+        gpuBarrier(commandBuffer, STAGE_ACCELERATION_STRUCTURE_BUILD, STAGE_COMPUTE, HAZARD_ACCELERATION_STRUCTURE);
+
         if (nextFrame > FRAMES_IN_FLIGHT)
         {
             gpuWaitSemaphore(semaphore, nextFrame - FRAMES_IN_FLIGHT);
@@ -309,7 +361,7 @@ int main(int argc, char** argv)
     gpuWaitSemaphore(semaphore, nextFrame - 1);
 
     test::Image actual = test::readbackRGBA8(device, queue, capture, RENDER_W, RENDER_H);
-    int rc = test::finalize(args, "raytracing", actual);
+    int rc = test::finalize(args, TEST_NAME, actual, TEST_REFERENCE);
 
     allocator.reset();
     descriptorAllocator.reset();
@@ -331,6 +383,11 @@ int main(int argc, char** argv)
     gpuFree(device, blasPtr);
     gpuDestroyAccelerationStructure(tlas);
     gpuFree(device, tlasPtr);
+#ifdef TEST_INDIRECT_TLAS
+    gpuFreePipeline(instancesPipeline);
+    gpuFree(device, tlasInstances);
+    gpuFree(device, tlasRange);
+#endif
     gpuFree(device, scratchPtr);
     gpuFree(device, pixelSample);
     gpuFree(device, prevPixelSample);
@@ -342,7 +399,7 @@ int main(int argc, char** argv)
 
     if (test::validationFailed())
     {
-        std::cerr << "FAIL [raytracing]: Vulkan validation messages were emitted\n";
+        std::cerr << "FAIL [" << TEST_NAME << "]: Vulkan validation messages were emitted\n";
         rc = 1;
     }
     return rc;
@@ -0,0 +1,121 @@
+// Headless test for pipeline entry points and specialization constants. One
+// module per stage holds two entry points; the pipeline picks the non-default
+// pair (scaledVertex, constantPixel) and sets both of Specialized.slang's
+// constants: the quad's half-extent, read by the vertex stage, and its color,
+// read by the pixel stage. With the module defaults, or the other entries,
+// the quad would be white and full screen. Checked exactly on the CPU: the
+// quad's edges fall on pixel boundaries, so every pixel is either the
+// constant color or the clear color.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator, loadIR
+#include "Raster.h"    // RasterVertexData, RasterPixelData
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [specialization]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    const uint32_t size = 64;
+    const float quadScale = 0.5f; // covers pixels [16, 48) on both axes
+    const uint32_t quadColor = 0xff20c040;
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+
+    GpuTextureDesc colorDesc = { .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .format = FORMAT_RGBA8_UNORM, .usage = (USAGE_FLAGS)(USAGE_COLOR_ATTACHMENT | USAGE_TRANSFER_SRC) };
+    GpuTextureSizeAlign sa = gpuTextureSizeAlign(device, colorDesc);
+    void* colorPtr = gpuMalloc(device, sa.size, MEMORY_GPU);
+    auto color = gpuCreateTexture(device, colorDesc, colorPtr);
+
+    uint32_t scaleBits;
+    memcpy(&scaleBits, &quadScale, sizeof(scaleBits));
+    GpuSpecConstant specConstants[2] = {
+        { .id = 7, .value = scaleBits },
+        { .id = 8, .value = quadColor },
+    };
+
+    ColorTarget colorTarget = { .format = FORMAT_RGBA8_UNORM };
+    GpuRasterDesc rasterDesc = { .colorTargets = Span<ColorTarget>(&colorTarget, 1) };
+    auto vertexIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/SpecializedVertex.spv");
+    auto pixelIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/SpecializedPixel.spv");
+    auto pipeline = gpuCreateGraphicsPipeline(device, ByteSpan(vertexIR), ByteSpan(pixelIR), rasterDesc,
+                                              "scaledVertex", "constantPixel", Span<GpuSpecConstant>(specConstants, 2));
+
+    auto indices = allocator.allocate<uint32_t>(6);
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        indices.cpu[i] = i;
+    }
+    auto vertexData = allocator.allocate<RasterVertexData>(1);
+    auto pixelData = allocator.allocate<RasterPixelData>(1);
+
+    auto commandBuffer = gpuStartCommandRecording(queue);
+    GpuRenderPassDesc renderPassDesc = { .colorTargets = Span<GpuTexture>(&color, 1) };
+    gpuSetPipeline(commandBuffer, pipeline);
+    gpuBeginRenderPass(commandBuffer, renderPassDesc);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, indices.gpu, 6, 1);
+    gpuEndRenderPass(commandBuffer);
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    test::Image rendered = test::readbackRGBA8(device, queue, color, size, size);
+
+    const uint8_t inside[4] = { 0x40, 0xc0, 0x20, 0xff };
+    const uint8_t outside[4] = { 0x00, 0x00, 0x00, 0xff };
+    uint32_t mismatches = 0;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            const bool covered = x >= 16 && x < 48 && y >= 16 && y < 48;
+            if (memcmp(&rendered.rgba[(y * size + x) * 4], covered ? inside : outside, 4) != 0)
+            {
+                mismatches++;
+            }
+        }
+    }
+    int rc = 0;
+    if (mismatches > 0)
+    {
+        const uint8_t* center = &rendered.rgba[((size / 2) * size + size / 2) * 4];
+        std::cerr << "FAIL [specialization]: " << mismatches << " pixels differ; center is " << int(center[0]) << "," << int(center[1]) << ","
+                  << int(center[2]) << "," << int(center[3]) << " (expected 64,192,32,255)\n";
+        rc = 1;
+    }
+    else
+    {
+        std::cout << "PASS [specialization]\n";
+    }
+
+    allocator.reset();
+    gpuDestroySemaphore(semaphore);
+    gpuDestroyTexture(color);
+    gpuFree(device, colorPtr);
+    gpuFreePipeline(pipeline);
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [specialization]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}
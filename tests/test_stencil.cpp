@@ -0,0 +1,202 @@
+// Headless test for stencil masking. A first pass clears stencil to 0 and
+// draws a triangle with test ALWAYS / pass REPLACE, so 1 is written where
+// it lands (the ALWAYS + non-KEEP case that must still enable the stencil
+// test). A second pass loads that stencil and draws a full-screen quad with
+// test EQUAL 1. The pipeline names only a combined depthFormat, so its
+// stencil attachment format is derived from it. The color target (left) and
+// the stencil aspect copied out through GpuTextureRegion::stencil (right,
+// white where 1) go to a golden; the two halves must also agree exactly.
+#include "test_common.h"
+
+#include "Utilities.h" // LinearAllocator, loadIR
+#include "Raster.h"    // RasterVertexData, RasterPixelData
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, char** argv)
+{
+    test::Args args = test::parseArgs(argc, argv);
+
+    gpuCreateInstance();
+    test::beginValidationCapture();
+
+    auto device = gpuCreateDevice(args.device);
+    if (!device)
+    {
+        std::cerr << "FAIL [stencil]: no suitable device at index " << args.device << "\n";
+        return 1;
+    }
+
+    // Devices support at least one of the two combined formats.
+    const USAGE_FLAGS depthStencilUsage = (USAGE_FLAGS)(USAGE_DEPTH_STENCIL_ATTACHMENT | USAGE_TRANSFER_SRC);
+    FORMAT depthStencilFormat = FORMAT_D32_FLOAT_S8_UINT;
+    if (!gpuFormatSupported(device, depthStencilFormat, depthStencilUsage))
+    {
+        depthStencilFormat = FORMAT_D24_UNORM_S8_UINT;
+    }
+    if (!gpuFormatSupported(device, depthStencilFormat, depthStencilUsage))
+    {
+        std::cout << "SKIP [stencil]: device has no combined depth/stencil format\n";
+        gpuDestroyDevice(device);
+        test::endValidationCapture();
+        gpuDestroyInstance();
+        return 0;
+    }
+
+    const uint32_t size = 64;
+
+    auto queue = gpuCreateQueue(device);
+    auto semaphore = gpuCreateSemaphore(device, 0);
+    LinearAllocator allocator(device);
+
+    auto makeTexture = [&](GpuTextureDesc desc, void** ptrOut)
+    {
+        GpuTextureSizeAlign sa = gpuTextureSizeAlign(device, desc);
+        *ptrOut = gpuMalloc(device, sa.size, MEMORY_GPU);
+        return gpuCreateTexture(device, desc, *ptrOut);
+    };
+
+    void* colorPtr;
+    auto color = makeTexture({ .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .format = FORMAT_RGBA8_UNORM, .usage = (USAGE_FLAGS)(USAGE_COLOR_ATTACHMENT | USAGE_TRANSFER_SRC) }, &colorPtr);
+    void* depthStencilPtr;
+    auto depthStencil = makeTexture({ .type = TEXTURE_2D, .dimensions = { size, size, 1 }, .format = depthStencilFormat, .usage = depthStencilUsage }, &depthStencilPtr);
+
+    ColorTarget colorTarget = { .format = FORMAT_RGBA8_UNORM };
+    GpuRasterDesc rasterDesc = {
+        .depthFormat = depthStencilFormat, // stencilFormat left NONE: derived from depthFormat
+        .colorTargets = Span<ColorTarget>(&colorTarget, 1)
+    };
+    auto vertexIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterVertex.spv");
+    auto pixelIR = loadIR(std::string(NGAPI_TEST_SHADER_DIR) + "/tests/RasterPixel.spv");
+    auto pipeline = gpuCreateGraphicsPipeline(device, ByteSpan(vertexIR), ByteSpan(pixelIR), rasterDesc);
+
+    GpuDepthStencilDesc writeDesc = {};
+    writeDesc.stencilFront = { .test = OP_ALWAYS, .passOp = OP_REPLACE, .reference = 1 };
+    writeDesc.stencilBack = writeDesc.stencilFront;
+    auto writeMask = gpuCreateDepthStencilState(writeDesc);
+
+    GpuDepthStencilDesc testDesc = {};
+    testDesc.stencilFront = { .test = OP_EQUAL, .reference = 1 };
+    testDesc.stencilBack = testDesc.stencilFront;
+    auto testMask = gpuCreateDepthStencilState(testDesc);
+
+    // Vertices 0-2: the mask triangle (dark blue). 3-6: a full-screen quad
+    // (yellow) drawn through the mask.
+    const float4 positions[7] = {
+        { -0.7f, -0.8f, 0.5f, 1.0f }, { 0.8f, -0.4f, 0.5f, 1.0f }, { -0.2f, 0.9f, 0.5f, 1.0f },
+        { -1.0f, -1.0f, 0.5f, 1.0f }, { 1.0f, -1.0f, 0.5f, 1.0f }, { 1.0f, 1.0f, 0.5f, 1.0f }, { -1.0f, 1.0f, 0.5f, 1.0f }
+    };
+    const float4 colors[7] = {
+        { 0.0f, 0.0f, 0.5f, 1.0f }, { 0.0f, 0.0f, 0.5f, 1.0f }, { 0.0f, 0.0f, 0.5f, 1.0f },
+        { 1.0f, 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f, 1.0f }
+    };
+    const uint32_t triangleIndices[3] = { 0, 1, 2 };
+    const uint32_t quadIndices[6] = { 3, 4, 5, 3, 5, 6 };
+    auto vertexPositions = allocator.allocate<float4>(7);
+    memcpy(vertexPositions.cpu, positions, sizeof(positions));
+    auto vertexColors = allocator.allocate<float4>(7);
+    memcpy(vertexColors.cpu, colors, sizeof(colors));
+    auto triangle = allocator.allocate<uint32_t>(3);
+    memcpy(triangle.cpu, triangleIndices, sizeof(triangleIndices));
+    auto quad = allocator.allocate<uint32_t>(6);
+    memcpy(quad.cpu, quadIndices, sizeof(quadIndices));
+
+    auto vertexData = allocator.allocate<RasterVertexData>(1);
+    vertexData.cpu->positions = vertexPositions.gpu;
+    vertexData.cpu->colors = vertexColors.gpu;
+    auto pixelData = allocator.allocate<RasterPixelData>(1);
+    pixelData.cpu->tint = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    auto commandBuffer = gpuStartCommandRecording(queue);
+    gpuSetPipeline(commandBuffer, pipeline);
+
+    GpuRenderPassDesc writePass = {
+        .colorTargets = Span<GpuTexture>(&color, 1),
+        .depthStencilTarget = depthStencil,
+        .stencilLoadOp = LOAD_OP_CLEAR,
+        .stencilStoreOp = STORE_OP_STORE,
+        .clearStencil = 0
+    };
+    gpuBeginRenderPass(commandBuffer, writePass);
+    gpuSetDepthStencilState(commandBuffer, writeMask);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, triangle.gpu, 3, 1);
+    gpuEndRenderPass(commandBuffer);
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 1);
+    gpuWaitSemaphore(semaphore, 1);
+
+    // The mask outlives the first pass: load it instead of clearing.
+    commandBuffer = gpuStartCommandRecording(queue);
+    gpuSetPipeline(commandBuffer, pipeline);
+    GpuRenderPassDesc testPass = {
+        .colorTargets = Span<GpuTexture>(&color, 1),
+        .depthStencilTarget = depthStencil,
+        .loadOp = LOAD_OP_LOAD,
+        .stencilLoadOp = LOAD_OP_LOAD,
+        .stencilStoreOp = STORE_OP_STORE
+    };
+    gpuBeginRenderPass(commandBuffer, testPass);
+    gpuSetDepthStencilState(commandBuffer, testMask);
+    gpuDrawIndexedInstanced(commandBuffer, vertexData.gpu, pixelData.gpu, quad.gpu, 6, 1);
+    gpuEndRenderPass(commandBuffer);
+
+    gpuSubmit(queue, Span<GpuCommandBuffer>(&commandBuffer, 1), semaphore, 2);
+    gpuWaitSemaphore(semaphore, 2);
+
+    test::Image rendered = test::readbackRGBA8(device, queue, color, size, size);
+    std::vector<uint8_t> stencil = test::readbackRegion(device, queue, depthStencil, GpuTextureRegion{ .stencil = true }, size * size);
+
+    // Color on the left, the stencil mask on the right.
+    test::Image actual;
+    actual.width = size * 2;
+    actual.height = size;
+    actual.rgba.resize(static_cast<size_t>(actual.width) * actual.height * 4);
+    uint32_t mismatches = 0;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        memcpy(&actual.rgba[y * actual.width * 4], &rendered.rgba[y * size * 4], size * 4);
+        for (uint32_t x = 0; x < size; x++)
+        {
+            const uint8_t value = stencil[y * size + x];
+            uint8_t* pixel = &actual.rgba[(y * actual.width + size + x) * 4];
+            pixel[0] = pixel[1] = pixel[2] = value == 1 ? 255 : 0;
+            pixel[3] = 255;
+
+            // Yellow exactly where the mask is 1, which covers the whole triangle.
+            const uint8_t* drawn = &rendered.rgba[(y * size + x) * 4];
+            const bool yellow = drawn[0] == 255 && drawn[1] == 255 && drawn[2] == 0;
+            if (value > 1 || yellow != (value == 1))
+            {
+                mismatches++;
+            }
+        }
+    }
+    int rc = test::finalize(args, "stencil", actual);
+    if (mismatches > 0)
+    {
+        std::cerr << "FAIL [stencil]: " << mismatches << " pixels disagree with the stencil mask\n";
+        rc = 1;
+    }
+
+    allocator.reset();
+    gpuDestroySemaphore(semaphore);
+    gpuDestroyTexture(color);
+    gpuFree(device, colorPtr);
+    gpuDestroyTexture(depthStencil);
+    gpuFree(device, depthStencilPtr);
+    gpuFreePipeline(pipeline);
+    gpuFreeDepthStencilState(writeMask);
+    gpuFreeDepthStencilState(testMask);
+    gpuDestroyQueue(queue);
+    gpuDestroyDevice(device);
+    test::endValidationCapture();
+    gpuDestroyInstance();
+
+    if (test::validationFailed())
+    {
+        std::cerr << "FAIL [stencil]: Vulkan validation messages were emitted\n";
+        rc = 1;
+    }
+    return rc;
+}